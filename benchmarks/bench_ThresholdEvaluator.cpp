@@ -0,0 +1,184 @@
+// Compares the batch threshold evaluator against the per threshold loop
+// thresholds::checkThresholds() ran before, which built a vector of changes
+// for every sample. Sensors get a warning and a critical threshold on each
+// side with values spread across all of them. Reports sensors evaluated per
+// microsecond and heap allocations per batch.
+
+#include "SensorRegistry.hpp"
+#include "ThresholdEvaluator.hpp"
+#include "Thresholds.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+static size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    void* ptr = std::malloc(size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+struct LegacySensor
+{
+    std::vector<thresholds::Threshold> thresholds;
+    double hysteresisTrigger;
+    uint8_t alarms;
+};
+
+// the check thresholds::checkThresholds() did before the evaluator
+static std::vector<std::pair<thresholds::Threshold, bool>>
+    legacyCheck(const LegacySensor& sensor, double value)
+{
+    std::vector<std::pair<thresholds::Threshold, bool>> thresholdChanges;
+    for (const auto& threshold : sensor.thresholds)
+    {
+        if (threshold.direction == thresholds::Direction::HIGH)
+        {
+            if (value >= threshold.value)
+            {
+                thresholdChanges.emplace_back(threshold, true);
+            }
+            else if (value < (threshold.value - sensor.hysteresisTrigger))
+            {
+                thresholdChanges.emplace_back(threshold, false);
+            }
+        }
+        else
+        {
+            if (value <= threshold.value)
+            {
+                thresholdChanges.emplace_back(threshold, true);
+            }
+            else if (value > (threshold.value + sensor.hysteresisTrigger))
+            {
+                thresholdChanges.emplace_back(threshold, false);
+            }
+        }
+    }
+    return thresholdChanges;
+}
+
+static uint8_t legacyTransitions(const LegacySensor& sensor, double value)
+{
+    uint8_t alarms = sensor.alarms;
+    for (const auto& [threshold, asserted] : legacyCheck(sensor, value))
+    {
+        uint8_t bit =
+            thresholds::alarmBit(threshold.level, threshold.direction);
+        alarms = static_cast<uint8_t>(asserted ? (alarms | bit)
+                                               : (alarms & ~bit));
+    }
+    return static_cast<uint8_t>(alarms ^ sensor.alarms);
+}
+
+template <typename Evaluate>
+static void run(const char* name, size_t sensorCount, size_t iterations,
+                Evaluate&& evaluate)
+{
+    volatile unsigned int sink = 0;
+    size_t allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t ii = 0; ii < iterations; ii++)
+    {
+        sink = sink + evaluate();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double us = std::chrono::duration<double, std::micro>(elapsed).count();
+    std::printf("  %-8s %8.1f sensors/us %10.1f allocations/batch\n", name,
+                static_cast<double>(iterations * sensorCount) / us,
+                static_cast<double>(allocations - allocationsBefore) /
+                    static_cast<double>(iterations));
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 2000;
+    SensorRegistry& registry = SensorRegistry::get();
+    // the evaluator only reads the registry arrays, no Sensor sits behind
+    // the ids
+    std::vector<SensorRegistry::SensorId> ids;
+    std::vector<LegacySensor> legacy;
+    for (size_t sensorCount : {16, 256, 4096})
+    {
+        while (ids.size() < sensorCount)
+        {
+            SensorRegistry::SensorId id = registry.add(nullptr);
+            ids.push_back(id);
+            // thresholds at 10, 20, 80 and 90 on a 0 to 100 range, values
+            // stepping through every band and both hysteresis edges
+            registry.values[id] = static_cast<double>((id * 37) % 101);
+            registry.hysteresisTrigger[id] = 1;
+            registry.alarms[id] = static_cast<uint8_t>(id % 16);
+            LegacySensor& sensor = legacy.emplace_back();
+            sensor.hysteresisTrigger = 1;
+            sensor.alarms = registry.alarms[id];
+            for (const auto& [level, direction, value] :
+                 {std::tuple{thresholds::WARNING, thresholds::HIGH, 80.0},
+                  std::tuple{thresholds::WARNING, thresholds::LOW, 20.0},
+                  std::tuple{thresholds::CRITICAL, thresholds::HIGH, 90.0},
+                  std::tuple{thresholds::CRITICAL, thresholds::LOW, 10.0}})
+            {
+                registry.thresholdValues[thresholds::slot(level, direction)]
+                                        [id] = value;
+                sensor.thresholds.emplace_back(level, direction, value);
+            }
+        }
+
+        std::vector<uint8_t> transitions(sensorCount);
+        thresholds::evaluate(registry, ids.data(), sensorCount,
+                             transitions.data());
+        for (size_t ii = 0; ii < sensorCount; ii++)
+        {
+            if (transitions[ii] !=
+                legacyTransitions(legacy[ii], registry.values[ids[ii]]))
+            {
+                std::cerr << "evaluators disagree on sensor " << ii << "\n";
+                return 1;
+            }
+        }
+
+        std::printf("%zu sensors\n", sensorCount);
+        run("legacy", sensorCount, iterations, [&]() {
+            unsigned int any = 0;
+            for (size_t ii = 0; ii < sensorCount; ii++)
+            {
+                any |= legacyTransitions(legacy[ii],
+                                         registry.values[ids[ii]]);
+            }
+            return any;
+        });
+        run("ids", sensorCount, iterations, [&]() {
+            return thresholds::evaluate(registry, ids.data(), sensorCount,
+                                        transitions.data());
+        });
+        run("range", sensorCount, iterations, [&]() {
+            return thresholds::evaluateRange(registry, 0, sensorCount,
+                                             transitions.data());
+        });
+    }
+    return 0;
+}
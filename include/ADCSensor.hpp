@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SensorSnapshot.hpp"
 #include "Thresholds.hpp"
 #include "sensor.hpp"
 
@@ -60,21 +61,24 @@ class ADCSensor : public Sensor
               std::vector<thresholds::Threshold>&& thresholds,
               const double scaleFactor, PowerState readState,
               const std::string& sensorConfiguration,
-              std::optional<BridgeGpio>&& bridgeGpio);
+              std::optional<BridgeGpio>&& bridgeGpio,
+              unsigned int pollRateMs = defaultPollMs);
     ~ADCSensor();
 
+    static constexpr unsigned int defaultPollMs = 500;
+
   private:
     sdbusplus::asio::object_server& objServer;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    boost::asio::streambuf readBuf;
+    std::shared_ptr<SensorSnapshot> snapshot;
     std::string path;
     size_t errCount;
     double scaleFactor;
     std::optional<BridgeGpio> bridgeGpio;
     PowerState readState;
+    unsigned int pollRateMs;
     thresholds::ThresholdTimer thresholdTimer;
     void setupRead(void);
-    void handleResponse(const boost::system::error_code& err);
+    void handleResponse(const boost::system::error_code& err,
+                        const std::optional<double>& reading);
     void checkThresholds(void) override;
 };
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary alternative to the key=value sensor source, for producers that update
+// at a high rate. The file is a header, a table of fixed size names and one
+// fixed size slot per name, all at offsets given by the header. Producers map
+// it and write slots in place, readers map it and copy a slot by index, so a
+// sample is neither read through a syscall nor parsed. A seqlock generation in
+// the header is odd while the producer is writing, readers retry a copy that
+// raced with a write.
+namespace binsnapshot
+{
+// "SNAP" in file byte order
+constexpr uint32_t magic = 0x50414e53;
+constexpr uint16_t version = 1;
+constexpr size_t nameSize = 64;
+
+enum class SlotStatus : uint32_t
+{
+    ok = 0,
+    unavailable = 1,
+    failed = 2
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t slotCount;
+    uint32_t nameSize;
+    uint64_t namesOffset;
+    uint64_t slotsOffset;
+    uint64_t generation;
+};
+
+struct Slot
+{
+    double value;
+    // CLOCK_MONOTONIC of the producer's last write
+    uint64_t timestampUs;
+    SlotStatus status;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 40, "header layout is part of the format");
+static_assert(sizeof(Slot) == 24, "slot layout is part of the format");
+
+size_t fileSize(size_t slotCount);
+} // namespace binsnapshot
+
+class BinarySnapshotReader
+{
+  public:
+    BinarySnapshotReader() = default;
+    ~BinarySnapshotReader();
+    BinarySnapshotReader(const BinarySnapshotReader&) = delete;
+    BinarySnapshotReader& operator=(const BinarySnapshotReader&) = delete;
+
+    // false if path is not a binary snapshot of a known version
+    bool open(const std::string& path);
+    void close(void);
+    bool isOpen(void) const
+    {
+        return header != nullptr;
+    }
+    // true once path refers to another file than the one mapped, producers
+    // changing the name table write a new file and rename it over the old one
+    bool replaced(const std::string& path) const;
+
+    std::optional<size_t> findSlot(std::string_view name) const;
+    // consistent copy of a slot, false if the producer kept writing over it
+    bool readSlot(size_t index, binsnapshot::Slot& slot) const;
+    uint64_t getGeneration(void) const;
+
+  private:
+    void* map = nullptr;
+    size_t mapSize = 0;
+    dev_t device = 0;
+    ino_t inode = 0;
+    const binsnapshot::Header* header = nullptr;
+    const char* names = nullptr;
+    const binsnapshot::Slot* slots = nullptr;
+};
+
+class BinarySnapshotWriter
+{
+  public:
+    BinarySnapshotWriter() = default;
+    ~BinarySnapshotWriter();
+    BinarySnapshotWriter(const BinarySnapshotWriter&) = delete;
+    BinarySnapshotWriter& operator=(const BinarySnapshotWriter&) = delete;
+
+    // lays out a new file for names and atomically replaces path with it,
+    // every slot starts out unavailable
+    bool create(const std::string& path, const std::vector<std::string>& names);
+
+    std::optional<size_t> findSlot(std::string_view name) const;
+
+    // slots written between begin and commit are published together
+    void begin(void);
+    void set(size_t index, double value,
+             binsnapshot::SlotStatus status = binsnapshot::SlotStatus::ok);
+    void commit(void);
+
+  private:
+    void* map = nullptr;
+    size_t mapSize = 0;
+    binsnapshot::Header* header = nullptr;
+    const char* names = nullptr;
+    binsnapshot::Slot* slots = nullptr;
+
+    void close(void);
+};
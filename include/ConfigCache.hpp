@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Utils.hpp"
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+#include <functional>
+#include <memory>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <string>
+#include <vector>
+
+// EntityManager's configuration, read once with an asynchronous
+// GetManagedObjects and then kept current by applying its InterfacesAdded,
+// InterfacesRemoved and PropertiesChanged signals, so a reconfiguration costs
+// what changed rather than a blocking re-read of everything. Objects are
+// indexed by interface name, a lookup by configuration type walks only the
+// interfaces starting with that type.
+class ConfigCache
+{
+  public:
+    // interface and properties name what changed when that was only
+    // properties of one interface, both are empty if interfaces were added
+    // or removed or everything was read again
+    using ChangeCallback = std::function<void(
+        const std::string& path, const std::string& interface,
+        const std::vector<std::string>& properties)>;
+
+    static ConfigCache&
+        get(const std::shared_ptr<sdbusplus::asio::connection>& conn);
+
+    ConfigCache(const ConfigCache&) = delete;
+    ConfigCache& operator=(const ConfigCache&) = delete;
+
+    // starts the initial read, ready runs once it completed, at once if it
+    // already did. A read that fails is retried until EntityManager answers.
+    void load(std::function<void(void)>&& ready = nullptr);
+    bool isLoaded(void) const
+    {
+        return loaded;
+    }
+    // replaces the contents with a read done elsewhere
+    void assign(ManagedObjectType&& objects);
+
+    // adds every object with an interface starting with type to resp
+    void find(const std::string& type, ManagedObjectType& resp) const;
+    // runs for each object added, removed or changed after the initial read,
+    // for every object before and after a complete re-read
+    void onChange(ChangeCallback&& callback);
+
+  private:
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    ManagedObjectType objects;
+    // interface name to the objects implementing it
+    boost::container::flat_map<std::string,
+                               boost::container::flat_set<std::string>>
+        byInterface;
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+    std::vector<std::function<void(void)>> readyCallbacks;
+    std::vector<ChangeCallback> changeCallbacks;
+    boost::asio::deadline_timer retryTimer;
+    bool loaded = false;
+    bool loading = false;
+    // a signal that could not be applied arrived, read everything again
+    bool stale = false;
+    // the last read failed and is being retried
+    bool readFailed = false;
+
+    explicit ConfigCache(
+        const std::shared_ptr<sdbusplus::asio::connection>& conn);
+
+    void read(void);
+    void rebuildIndex(void);
+    void addInterfaces(const std::string& path, SensorData&& interfaces);
+    void removeInterfaces(const std::string& path,
+                          const std::vector<std::string>& interfaces);
+    void changeProperties(const std::string& path,
+                          const std::string& interface,
+                          SensorBaseConfigMap&& values);
+    void changed(const std::string& path, const std::string& interface = "",
+                 const std::vector<std::string>& properties = {});
+};
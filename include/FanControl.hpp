@@ -0,0 +1,121 @@
+#pragma once
+
+#include "PollScheduler.hpp"
+#include "PwmSensor.hpp"
+#include "SensorConfig.hpp"
+#include "SensorRegistry.hpp"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/container/flat_map.hpp>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Sensor;
+
+// Closed loop fan control run inside the daemon, configured like
+// phosphor-pid-control. Each zone is a task on the PollScheduler with its own
+// period; a step reads its inputs straight from the SensorRegistry, runs its
+// controllers and writes the duty to its PwmSensors, with no D-Bus round trip
+// in between.
+namespace fancontrol
+{
+using PwmSensors =
+    boost::container::flat_map<std::string, std::unique_ptr<PwmSensor>>;
+
+// one Pid or Stepwise configuration and its state between steps
+class Controller
+{
+  public:
+    explicit Controller(const sensorconfig::ControllerDescriptor& config);
+
+    // output for the input reading, dt the seconds since the last step
+    double step(double input, double setPoint, double dt);
+    void reset(void);
+
+    bool isFan(void) const
+    {
+        return config.fan;
+    }
+    double getSetPoint(void) const
+    {
+        return config.setPoint;
+    }
+
+    // zone input index of every input of this controller
+    std::vector<size_t> inputs;
+
+  private:
+    sensorconfig::ControllerDescriptor config;
+    double integral = 0;
+    double lastOutput = 0;
+    double lastInput = std::numeric_limits<double>::quiet_NaN();
+    bool started = false;
+
+    double pid(double input, double setPoint, double dt);
+    double stepwise(double input);
+};
+
+// Thermal controllers turn temperatures into the zone's demand, the largest
+// of their outputs and MinThermalOutput. Fan controllers, if the zone has any,
+// follow that demand on their tach inputs and their largest output is the
+// duty, otherwise the demand is the duty. While any input reads NaN the
+// controllers are held and the zone runs at FailSafePercent.
+class Zone
+{
+  public:
+    Zone(sensorconfig::ZoneDescriptor&& config, const PwmSensors& pwmSensors);
+
+    void step(void);
+
+    const std::string& getName(void) const
+    {
+        return name;
+    }
+    unsigned int getPeriodMs(void) const
+    {
+        return periodMs;
+    }
+
+  private:
+    struct Input
+    {
+        std::string name;
+        SensorRegistry::SensorId id = 0;
+        // identifies the sensor id was resolved for, null until found
+        Sensor* sensor = nullptr;
+    };
+
+    std::string name;
+    unsigned int periodMs;
+    double minThermalOutput;
+    double failSafePercent;
+    std::vector<Input> inputs;
+    std::vector<Controller> controllers;
+    std::vector<PwmSensor*> outputs;
+    std::vector<double> readings;
+    bool failSafe = false;
+
+    size_t addInput(const std::string& inputName);
+    // looks input up again after its sensor was created or replaced
+    bool resolve(Input& input);
+};
+
+class FanControl
+{
+  public:
+    FanControl(boost::asio::io_service& io,
+               std::vector<sensorconfig::ZoneDescriptor>&& zones,
+               const PwmSensors& pwmSensors);
+    ~FanControl();
+    FanControl(const FanControl&) = delete;
+    FanControl& operator=(const FanControl&) = delete;
+
+  private:
+    PollScheduler& scheduler;
+    std::vector<std::unique_ptr<Zone>> zones;
+    std::vector<PollScheduler::TaskId> tasks;
+};
+} // namespace fancontrol
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "SensorSnapshot.hpp"
 #include "Thresholds.hpp"
 #include "sensor.hpp"
 
+#include <optional>
 #include <sdbusplus/asio/object_server.hpp>
 #include <string>
 #include <vector>
@@ -17,19 +19,22 @@ class HwmonTempSensor : public Sensor,
                     boost::asio::io_service& io, const std::string& fanName,
                     std::vector<thresholds::Threshold>&& thresholds,
                     const std::string& sensorConfiguration,
-                    const PowerState powerState);
+                    const PowerState powerState,
+                    unsigned int pollRateMs = defaultPollMs);
     ~HwmonTempSensor();
     void setupRead(void);
 
+    static constexpr unsigned int defaultPollMs = 500;
+
   private:
     sdbusplus::asio::object_server& objServer;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    boost::asio::streambuf readBuf;
+    std::shared_ptr<SensorSnapshot> snapshot;
     std::string path;
     PowerState readState;
     size_t errCount;
+    unsigned int pollRateMs;
 
-    void handleResponse(const boost::system::error_code& err);
+    void handleResponse(const boost::system::error_code& err,
+                        const std::optional<double>& reading);
     void checkThresholds(void) override;
 };
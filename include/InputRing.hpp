@@ -0,0 +1,38 @@
+#pragma once
+
+#include <liburing.h>
+
+#include <cstddef>
+
+class SensorInput;
+
+// Shared io_uring for sensor inputs. Inputs due in the same scheduler batch
+// queue their reads here first, the first one read submits all of them with
+// a single io_uring_enter and every completion is handed back to its input,
+// so a batch costs about one syscall instead of one pread per input.
+class InputRing
+{
+  public:
+    // nullptr when the kernel does not support io_uring, inputs then read
+    // with pread
+    static InputRing* getRing(void);
+
+    InputRing(const InputRing&) = delete;
+    InputRing& operator=(const InputRing&) = delete;
+
+    // false when the read could not be queued, the input reads on its own
+    bool queue(SensorInput& input, int fd, char* buffer, size_t size);
+    // submits everything queued and waits for all of it to complete
+    void submit(void);
+
+  private:
+    static constexpr unsigned int ringEntries = 256;
+
+    struct io_uring ring = {};
+    unsigned int queued = 0;
+    // set after a failed submit, nothing queued since will ever complete
+    bool broken = false;
+
+    InputRing(void) = default;
+    bool init(void);
+};
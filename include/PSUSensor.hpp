@@ -1,10 +1,12 @@
 #pragma once
 
 #include "PwmSensor.hpp"
+#include "SensorSnapshot.hpp"
 #include "Thresholds.hpp"
 #include "sensor.hpp"
 
 #include <memory>
+#include <optional>
 #include <sdbusplus/asio/object_server.hpp>
 #include <string>
 
@@ -18,23 +20,24 @@ class PSUSensor : public Sensor
               std::vector<thresholds::Threshold>&& thresholds,
               const std::string& sensorConfiguration,
               std::string& sensorTypeName, unsigned int factor, double max,
-              double min, const std::string& label, size_t tSize);
+              double min, const std::string& label, size_t tSize,
+              unsigned int pollRateMs = defaultPollMs);
     ~PSUSensor();
 
+    static constexpr unsigned int defaultPollMs = 1000;
+
   private:
     sdbusplus::asio::object_server& objServer;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    boost::asio::streambuf readBuf;
+    std::shared_ptr<SensorSnapshot> snapshot;
     std::string path;
     size_t errCount;
     unsigned int sensorFactor;
+    unsigned int pollRateMs;
     void setupRead(void);
-    void handleResponse(const boost::system::error_code& err);
+    void handleResponse(const boost::system::error_code& err,
+                        const std::optional<double>& reading);
     void checkThresholds(void) override;
 
-    int fd;
-    static constexpr unsigned int sensorPollMs = 1000;
     static constexpr size_t warnAfterErrorCount = 10;
 };
 
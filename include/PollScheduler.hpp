@@ -0,0 +1,139 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Hierarchical timer wheel counting in scheduler ticks. Level 0 holds the
+// next 64 ticks one slot per tick, every level above covers 64 times the span
+// of the one below and is cascaded down as time reaches it, so inserting and
+// expiring an entry is O(1) no matter how many are pending.
+class TimerWheel
+{
+  public:
+    static constexpr unsigned int slotBits = 6;
+    static constexpr unsigned int slotCount = 1U << slotBits;
+    static constexpr unsigned int levelCount = 4;
+
+    struct Entry
+    {
+        uint64_t expiry;
+        size_t id;
+        uint64_t serial;
+    };
+
+    // entries due at or before now are moved to the next tick
+    void insert(const Entry& entry);
+    // moves time forward to tick, appending every expired entry to expired
+    void advance(uint64_t tick, std::vector<Entry>& expired);
+    // earliest tick something may expire or need cascading, if anything
+    std::optional<uint64_t> nextExpiry(void) const;
+
+    uint64_t now(void) const
+    {
+        return current;
+    }
+
+  private:
+    uint64_t current = 0;
+    std::array<std::array<std::vector<Entry>, slotCount>, levelCount> slots;
+    std::array<uint64_t, levelCount> occupied = {};
+
+    void place(const Entry& entry);
+    void cascade(unsigned int level);
+};
+
+// Central poll scheduler. Every periodic task of the daemon is an entry on one
+// timer wheel behind a single timerfd, instead of one deadline_timer per
+// sensor. Tasks are aligned to a grid of their period plus phase, so tasks
+// that share a period and phase always fire in the same batch.
+class PollScheduler
+{
+  public:
+    using TaskId = size_t;
+    static constexpr unsigned int tickMs = 10;
+
+    // work done per wakeup, to see how evenly polling is spread
+    struct Stats
+    {
+        uint64_t batches = 0;
+        uint64_t tasks = 0;
+        uint64_t maxBatchTasks = 0;
+        uint64_t busyUs = 0;
+        uint64_t maxBatchUs = 0;
+    };
+
+    explicit PollScheduler(boost::asio::io_service& io);
+    ~PollScheduler();
+    PollScheduler(const PollScheduler&) = delete;
+    PollScheduler& operator=(const PollScheduler&) = delete;
+
+    // returns the scheduler shared by everything running on io
+    static PollScheduler& getScheduler(boost::asio::io_service& io);
+
+    // prepare, if set, runs for every task of a batch before the first
+    // callback, so work can be queued up and completed in one go
+    TaskId add(unsigned int periodMs, unsigned int phaseMs,
+               std::function<void(void)>&& callback,
+               std::function<void(void)>&& prepare = nullptr);
+    void remove(TaskId id);
+    // moves a task to a new period and phase, keeping its callback
+    void setPeriod(TaskId id, unsigned int periodMs, unsigned int phaseMs);
+
+    // incremented once per wakeup, tasks fired together see the same value
+    uint64_t getBatch(void) const
+    {
+        return batch;
+    }
+
+    uint64_t getTick(void) const
+    {
+        return wheel.now();
+    }
+
+    const Stats& getStats(void) const
+    {
+        return stats;
+    }
+
+    // deterministic offset within periodMs derived from name, so sensors
+    // sharing a period don't all fire on the same tick
+    static unsigned int phaseFor(std::string_view name, unsigned int periodMs);
+
+  private:
+    struct Task
+    {
+        uint64_t periodTicks;
+        uint64_t phaseTicks;
+        uint64_t serial;
+        bool active;
+        std::function<void(void)> callback;
+        std::function<void(void)> prepare;
+    };
+
+    boost::asio::posix::stream_descriptor timerFd;
+    TimerWheel wheel;
+    // deque so a callback adding a task does not move the running one
+    std::deque<Task> tasks;
+    std::vector<TaskId> freeTasks;
+    std::vector<TaskId> removedTasks;
+    std::vector<TimerWheel::Entry> expired;
+    timespec start = {};
+    std::optional<uint64_t> armedTick;
+    uint64_t batch = 0;
+    Stats stats;
+    bool dispatching = false;
+
+    uint64_t nowTicks(void) const;
+    uint64_t nextDue(const Task& task, uint64_t after) const;
+    void arm(void);
+    void waitTimer(void);
+    void handleTimer(void);
+};
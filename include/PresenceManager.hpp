@@ -0,0 +1,74 @@
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <gpiod.hpp>
+#include <string>
+#include <vector>
+
+class PresenceSensor;
+
+// Presence pins of every PresenceSensor. Pins added while sensors are being
+// created are requested together once that is done, one bulk request per
+// gpiochip and polarity, and the event fd of every line is registered in a
+// single epoll set watched by one stream_descriptor. A wakeup drains the
+// pending edges of every line, then reads each affected request's pins with
+// one bulk get and hands the changes to their sensors in one batch, so a
+// whole fan tray being pulled is handled in one pass.
+class PresenceManager
+{
+  public:
+    static PresenceManager& get(boost::asio::io_service& io);
+
+    PresenceManager(const PresenceManager&) = delete;
+    PresenceManager& operator=(const PresenceManager&) = delete;
+
+    // false if there is no such pin
+    bool add(PresenceSensor* sensor, const std::string& pinName,
+             bool inverted);
+    // releases the pins of sensor so they can be requested again
+    void remove(PresenceSensor* sensor);
+
+  private:
+    // free for reuse while sensor is null
+    struct Pin
+    {
+        gpiod::line line;
+        PresenceSensor* sensor = nullptr;
+        size_t group = 0;
+    };
+
+    // lines of one chip and polarity requested together, reused by the
+    // next pins added once all of its pins were removed
+    struct Group
+    {
+        std::string chipName;
+        bool inverted = false;
+        gpiod::line_bulk lines;
+        // index in pins of each line
+        std::vector<size_t> pins;
+        bool requested = false;
+        bool changed = false;
+    };
+
+    boost::asio::io_service& io;
+    boost::asio::posix::stream_descriptor epollFd;
+    std::vector<Pin> pins;
+    std::vector<Group> groups;
+    bool requestPending = false;
+    bool watching = false;
+
+    explicit PresenceManager(boost::asio::io_service& io);
+
+    // requests every group added since the last call
+    void request(void);
+    // requests the lines of group one by one after the bulk request failed,
+    // pins that cannot be requested leave the group
+    void requestEach(Group& group, const gpiod::line_request& config);
+    // makes the bulk of group match its pins again
+    void rebuild(Group& group);
+    void watch(void);
+    void drain(void);
+    // reads the pins of group and passes them on to their sensors
+    void apply(Group& group, bool edge);
+};
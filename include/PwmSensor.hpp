@@ -1,9 +1,22 @@
 #pragma once
 
+#include "PollScheduler.hpp"
+
+#include <boost/asio/deadline_timer.hpp>
+#include <cstdint>
 #include <memory>
 #include <sdbusplus/asio/object_server.hpp>
 #include <string>
 
+// Fan pwm exposed as a sensor and a FanPwm control. The pwm attribute stays
+// open, writes go straight to it with pwrite and D-Bus reads are answered
+// from the last value written or read back, the attribute is re-read every
+// refreshMs to pick up changes made behind our back.
+// Sets arriving within writeWindowMs of one another are combined, only the
+// latest duty is written once the window closes. D-Bus signals each Set
+// property as it is accepted, the other interface's property is signalled
+// once for the duty written. A window of 0 writes every Set as it arrives.
+// The number of Sets combined away is exposed as MergedWrites.
 class PwmSensor
 {
   public:
@@ -11,9 +24,22 @@ class PwmSensor
               std::shared_ptr<sdbusplus::asio::connection>& conn,
               sdbusplus::asio::object_server& objectServer,
               const std::string& sensorConfiguration,
-              const std::string& sensorType);
+              const std::string& sensorType,
+              unsigned int refreshMs = defaultRefreshMs,
+              unsigned int writeWindowMs = defaultWriteWindowMs);
     ~PwmSensor();
 
+    static constexpr unsigned int defaultRefreshMs = 1000;
+    static constexpr unsigned int defaultWriteWindowMs = 10;
+
+    const std::string& getName(void) const
+    {
+        return name;
+    }
+    // writes a duty in percent at once, replacing a pending Set, for the
+    // built in fan control
+    void setDuty(double percent);
+
   private:
     std::string sysPath;
     sdbusplus::asio::object_server& objectServer;
@@ -21,6 +47,31 @@ class PwmSensor
     std::shared_ptr<sdbusplus::asio::dbus_interface> sensorInterface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> controlInterface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> association;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> statsInterface;
+    PollScheduler& scheduler;
+    PollScheduler::TaskId refreshTask;
+    int fd = -1;
+    // a regular file standing in for the attribute is truncated on write
+    bool regularFile = false;
+    // last duty requested, written or read, 0 to pwmMax
+    uint32_t pwmValue = 0;
+    boost::asio::deadline_timer writeTimer;
+    unsigned int writeWindowMs;
+    // pwmValue is yet to be written
+    bool writePending = false;
+    // the pending duty was Set through Target rather than Value
+    bool setByTarget = false;
+    // Sets superseded by a later one before they were written
+    uint64_t mergedWrites = 0;
+
+    // writes value now or once the write window closes, byTarget tells
+    // which property was Set
+    void requestValue(uint32_t value, bool byTarget);
+    // signals the property that was not Set
+    void signalOther(void);
+    void applyValue(void);
     void setValue(uint32_t value);
-    uint32_t getValue(bool errThrow = true);
+    // false if the attribute could not be read or parsed
+    bool readValue(uint32_t& value);
+    void refresh(void);
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Parser for key=value sensor sources. It works on the read buffer in place:
+// keys and values are views into the buffer, numbers are converted with
+// std::from_chars and failures are reported as status codes, so parsing a
+// sample neither allocates nor throws.
+namespace reading
+{
+enum class ParseStatus
+{
+    ok,
+    empty,
+    invalid,
+    outOfRange
+};
+
+// trims blanks and a trailing carriage return
+std::string_view trim(std::string_view text);
+
+// splits "key=value", returns false if the line has no '='
+bool splitLine(std::string_view line, std::string_view& key,
+               std::string_view& value);
+
+// the whole (trimmed) text must be a number for the parse to succeed
+ParseStatus parseValue(std::string_view text, double& value);
+
+// calls callback(key, value) for every key=value line of buffer, lines
+// without a '=' are skipped. Returns the number of entries found.
+template <typename Callback>
+size_t parseLines(std::string_view buffer, Callback&& callback)
+{
+    size_t entries = 0;
+    while (!buffer.empty())
+    {
+        size_t end = buffer.find('\n');
+        std::string_view line = buffer.substr(0, end);
+        buffer.remove_prefix(end == std::string_view::npos ? buffer.size()
+                                                           : end + 1);
+        std::string_view key;
+        std::string_view value;
+        if (splitLine(line, key, value))
+        {
+            callback(key, value);
+            entries++;
+        }
+    }
+    return entries;
+}
+} // namespace reading
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Thresholds.hpp"
+#include "Utils.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Sensors described by EntityManager's flattened.json, read straight from
+// the file so they can be created before EntityManager is on the bus. The
+// file is mapped and fed through nlohmann's SAX interface, only the
+// properties of one configuration object are held at a time and no JSON
+// document is built. The Pid, Stepwise and Pid.Zone configurations of
+// phosphor-pid-control are read from it as well, for the built in fan control,
+// and the FanRedundancy groups.
+namespace sensorconfig
+{
+enum class SensorKind
+{
+    tach,
+    pwm,
+    psu,
+    adc,
+    temp
+};
+
+struct SensorDescriptor
+{
+    SensorKind kind;
+    std::string name;
+    // object path of the configuration in flattened.json
+    std::string configurationPath;
+    // configuration interface, xyz.openbmc_project.Configuration.<Type>
+    std::string configurationType;
+    // source of the reading, the pwm attribute for SensorKind::pwm
+    std::string inputPath;
+    std::vector<thresholds::Threshold> thresholds;
+    PowerState powerState = PowerState::on;
+    std::optional<double> minReading;
+    std::optional<double> maxReading;
+    // readings are divided by it, a whole number for SensorKind::psu
+    double scaleFactor = 1;
+    // 0 keeps the sensor's default
+    unsigned int pollRateMs = 0;
+    // PSU sensor type directory such as "power/"
+    std::string sensorType;
+};
+
+// source used by configurations without a Path
+constexpr const char* defaultInputPath = "/etc/sensor";
+
+enum class ControllerKind
+{
+    pid,
+    stepwise
+};
+
+// a Pid or Stepwise configuration, named as in phosphor-pid-control
+struct ControllerDescriptor
+{
+    ControllerKind kind;
+    std::string name;
+    // Class "fan" follows the zone's demand on tach inputs, anything else
+    // turns temperatures into that demand
+    bool fan = false;
+    std::vector<std::string> inputs;
+    // pwm sensors driven by the zone, the fan sensor name or "Pwm_" + it
+    std::vector<std::string> outputs;
+    std::vector<std::string> zones;
+
+    double setPoint = 0;
+    double pCoefficient = 0;
+    double iCoefficient = 0;
+    double ffGainCoefficient = 0;
+    double ffOffCoefficient = 0;
+    // a limit pair of 0 and 0 leaves that value unbounded
+    double iLimitMin = 0;
+    double iLimitMax = 0;
+    double outLimitMin = 0;
+    double outLimitMax = 0;
+    // largest change of the output per second, 0 for no limit
+    double slewNeg = 0;
+    double slewPos = 0;
+
+    // stepwise table, Output[i] from Reading[i] up to Reading[i + 1]
+    std::vector<double> readings;
+    std::vector<double> levels;
+    double positiveHysteresis = 0;
+    double negativeHysteresis = 0;
+};
+
+struct ZoneDescriptor
+{
+    std::string name;
+    double minThermalOutput = 0;
+    // duty in percent written while an input is NaN
+    double failSafePercent = 100;
+    unsigned int periodMs = defaultZonePeriodMs;
+    std::vector<ControllerDescriptor> controllers;
+
+    static constexpr unsigned int defaultZonePeriodMs = 1000;
+};
+
+// a FanRedundancy configuration
+struct RedundancyDescriptor
+{
+    std::string name;
+    std::string configurationPath;
+    size_t allowedFailures = 0;
+    // tach sensor names, every tach sensor when empty
+    std::vector<std::string> children;
+};
+
+// the daemon's own settings, an ExpManager configuration
+struct Settings
+{
+    // NotifyPaths, sources re-read whenever they are written instead of
+    // being polled
+    std::vector<std::string> notifyPaths;
+    // PublishWindowMs, value changes within it are signalled once with the
+    // latest value, 0 signals them at the end of the tick they happened in
+    unsigned int publishWindowMs = 0;
+};
+
+// appends every sensor configured in path, every fan control zone with its
+// controllers and every fan redundancy group and fills in settings, false if
+// it could not be read or is not valid JSON
+bool parseConfiguration(const std::string& path,
+                        std::vector<SensorDescriptor>& sensors,
+                        std::vector<ZoneDescriptor>& zones,
+                        std::vector<RedundancyDescriptor>& groups,
+                        Settings& settings);
+} // namespace sensorconfig
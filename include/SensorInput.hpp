@@ -0,0 +1,56 @@
+#pragma once
+
+#include <boost/system/error_code.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sensor input that keeps its descriptor open for the lifetime of the sensor
+// and re-reads it from offset 0 with pread, the usual way to re-read a sysfs
+// attribute. The descriptor is only reopened after a failed read, so a poll
+// costs one syscall instead of close/open/read. Sources have to be rewritten
+// in place, a file replaced by rename keeps being read from the old inode.
+class SensorInput
+{
+  public:
+    explicit SensorInput(const std::string& path);
+    ~SensorInput();
+    SensorInput(const SensorInput&) = delete;
+    SensorInput& operator=(const SensorInput&) = delete;
+
+    // returns the current contents of the source, the view stays valid until
+    // the next read. On failure ec is set and the descriptor is closed so the
+    // next read reopens it.
+    std::string_view read(boost::system::error_code& ec);
+
+    // queues the next read on the shared io_uring, read() then submits it
+    // together with every other queued input. Does nothing when built
+    // without io_uring or when it is unavailable.
+    void prefetch(void);
+
+    // open descriptor or -1, changes when the input is reopened
+    int getFd(void) const
+    {
+        return fd;
+    }
+
+  private:
+    enum class PrefetchState
+    {
+        idle,
+        queued,
+        done
+    };
+
+    std::string path;
+    int fd = -1;
+    std::vector<char> buffer;
+    PrefetchState prefetchState = PrefetchState::idle;
+    size_t prefetched = 0;
+
+    friend class InputRing;
+    void completePrefetch(int result);
+
+    bool openInput(boost::system::error_code& ec);
+    void closeInput(void);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <vector>
+
+struct Sensor;
+
+// Publish stage for sensor values. Sensors whose value changed are collected
+// instead of each emitting PropertiesChanged from updateValue, and all of
+// them are published together once the handler that updated them returned,
+// or once the window expired when one is set. A sensor changing again within
+// the window is published once with its latest value. A sensor raising or
+// clearing an alarm publishes its held value first.
+class SensorPublisher
+{
+  public:
+    // windowMs 0 publishes at the end of the current tick
+    static SensorPublisher& create(boost::asio::io_service& io,
+                                   unsigned int windowMs);
+    // nullptr until created, sensors then publish immediately
+    static SensorPublisher* get(void);
+
+    SensorPublisher(const SensorPublisher&) = delete;
+    SensorPublisher& operator=(const SensorPublisher&) = delete;
+
+    // takes effect from the next value collected
+    void setWindowMs(unsigned int newWindowMs)
+    {
+        windowMs = newWindowMs;
+    }
+
+    void add(Sensor* sensor);
+    void remove(Sensor* sensor);
+
+  private:
+    boost::asio::io_service& io;
+    boost::asio::deadline_timer timer;
+    unsigned int windowMs;
+    std::vector<Sensor*> dirty;
+    std::vector<Sensor*> flushing;
+    bool flushPending = false;
+
+    SensorPublisher(boost::asio::io_service& io, unsigned int windowMs);
+    void flush(void);
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <boost/container/flat_map.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Sensor;
+
+// Every live sensor under a stable id. The state touched on every sample is
+// kept here in one contiguous array per field instead of in the sensor
+// objects, which only keep their D-Bus plumbing, so loops over all sensors
+// walk a few dense arrays rather than chasing a pointer per sensor. Ids are
+// reused once a sensor is destroyed.
+//
+// A generation counter is bumped each time a sensor publishes a new value or
+// alarm state and stored for that sensor, so callers holding an older
+// generation can be handed only what changed since. A sensor destroyed
+// without a successor of the same name leaves a tombstone holding the
+// generation it went away at, so those callers learn about removals too.
+class SensorRegistry
+{
+  public:
+    using SensorId = size_t;
+    // one threshold per level and direction, see thresholds::slot()
+    static constexpr size_t thresholdSlots = 4;
+
+    static SensorRegistry& get(void);
+
+    SensorRegistry(const SensorRegistry&) = delete;
+    SensorRegistry& operator=(const SensorRegistry&) = delete;
+
+    // called by the Sensor constructor and destructor
+    SensorId add(Sensor* sensor);
+    void remove(SensorId id);
+
+    // keeps sensor alive until it is released
+    void own(std::shared_ptr<Sensor> sensor);
+    // destroys the owned sensor called name, with spaces turned into
+    // underscores as the sensor constructors do. Has to precede creating a
+    // sensor of the same name, the old one would otherwise still hold its
+    // D-Bus objects and snapshot subscription.
+    void release(const std::string& name);
+    // stamps a sensor with a new generation and the current time
+    void touch(SensorId id);
+
+    uint64_t getGeneration(void) const
+    {
+        return generation;
+    }
+    // ids in use are below this
+    size_t size(void) const
+    {
+        return sensors.size();
+    }
+    // nullptr for a free id
+    Sensor* getSensor(SensorId id) const
+    {
+        return sensors[id];
+    }
+    // name of every removed sensor and the generation it was removed at,
+    // dropped again once a sensor of that name is added
+    const boost::container::flat_map<std::string, uint64_t>&
+        getTombstones(void) const
+    {
+        return tombstones;
+    }
+
+    // hot per sensor state, indexed by id
+    std::vector<double> values;
+    // value before the last change
+    std::vector<double> lastValues;
+    std::vector<double> hysteresisTrigger;
+    std::vector<double> hysteresisPublish;
+    // NaN where a sensor has no threshold of that level and direction
+    std::array<std::vector<double>, thresholdSlots> thresholdValues;
+    // thresholds::alarmBit() of every asserted threshold
+    std::vector<uint8_t> alarms;
+    // thresholds::alarmBit() of every threshold waiting for its power on
+    // delay, asserted as far as threshold checks are concerned
+    std::vector<uint8_t> pendingAlarms;
+    // generation and wall clock time of the last published change
+    std::vector<uint64_t> generations;
+    std::vector<uint64_t> timestamps;
+
+  private:
+    std::vector<Sensor*> sensors;
+    std::vector<std::shared_ptr<Sensor>> owners;
+    std::vector<SensorId> freeIds;
+    boost::container::flat_map<std::string, uint64_t> tombstones;
+    uint64_t generation = 0;
+
+    SensorRegistry() = default;
+};
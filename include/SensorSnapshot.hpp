@@ -0,0 +1,123 @@
+#pragma once
+
+#include "BinarySnapshot.hpp"
+#include "PollScheduler.hpp"
+#include "SensorInput.hpp"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/container/flat_map.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Shared reader for a key=value sensor source such as /etc/sensor. Each
+// subscriber is polled by the PollScheduler at its own period, staggered by a
+// phase derived from its key. The file is read and parsed once per shortest
+// subscriber period by whichever subscriber comes due first, later ones are
+// handed the value stored under their key from that read, instead of every
+// sensor opening and scanning the whole file on its own.
+//
+// A source in the binary snapshot format is mapped instead, each subscriber
+// resolves its slot once and copies it on every poll without any parsing.
+//
+// In notify mode the source is instead re-read whenever it reports a change,
+// through inotify IN_CLOSE_WRITE for regular files or POLLPRI for sysfs
+// attributes that call sysfs_notify, and every subscriber is handed the new
+// value at once. No timer runs while notifications work, sources that cannot
+// notify stay on the timer.
+class SensorSnapshot : public std::enable_shared_from_this<SensorSnapshot>
+{
+  public:
+    // err is set when the source could not be read, reading is empty when the
+    // key was missing from the source or its value could not be parsed
+    using Callback = std::function<void(const boost::system::error_code& err,
+                                        const std::optional<double>& reading)>;
+
+    enum class UpdateMode
+    {
+        poll,
+        notify
+    };
+
+    SensorSnapshot(boost::asio::io_service& io, const std::string& path);
+    ~SensorSnapshot();
+
+    // returns the reader shared by every sensor polling path
+    static std::shared_ptr<SensorSnapshot>
+        getSnapshot(boost::asio::io_service& io, const std::string& path);
+
+    // owner identifies the subscription, a new owner subscribing to a key
+    // takes it over and the previous owner's calls for that key are ignored,
+    // so a sensor re-created under the same name before the old one is gone
+    // keeps its subscription
+    void subscribe(const std::string& key, const void* owner,
+                   unsigned int pollMs, Callback&& callback);
+    void unsubscribe(const std::string& key, const void* owner);
+    // changes the period a subscriber is polled at
+    void setPollRate(const std::string& key, const void* owner,
+                     unsigned int pollMs);
+    // falls back to poll if the source cannot notify, returns the mode used
+    UpdateMode setUpdateMode(UpdateMode newMode);
+
+  private:
+    static constexpr PollScheduler::TaskId noTask =
+        std::numeric_limits<PollScheduler::TaskId>::max();
+
+    struct Subscriber
+    {
+        const void* owner = nullptr;
+        PollScheduler::TaskId task = noTask;
+        unsigned int pollMs;
+        // view into the input buffer, only valid until the next read
+        std::string_view response;
+        // index into a binary source
+        std::optional<size_t> slot;
+        Callback callback;
+        bool removed = false;
+    };
+
+    boost::asio::io_service& io;
+    SensorInput input;
+    BinarySnapshotReader binary;
+    PollScheduler& scheduler;
+    std::string path;
+    boost::container::flat_map<std::string, Subscriber> subscribers;
+    std::optional<uint64_t> readTick;
+    unsigned int refreshMs = 0;
+    boost::system::error_code readErr;
+    size_t errCount = 0;
+    bool polling = false;
+    bool pendingRemoval = false;
+    bool refreshPending = false;
+
+    // inotify descriptor or a dup of the sysfs attribute's descriptor
+    boost::asio::posix::stream_descriptor notifyFd;
+    UpdateMode mode = UpdateMode::poll;
+    bool sysfsNotify = false;
+    bool notifyPosted = false;
+    alignas(8) std::array<char, 1024> notifyBuf;
+
+    void refresh(void);
+    void openBinary(void);
+    void updateRefreshMs(void);
+    void prepare(void);
+    void poll(const std::string& key);
+    void deliver(Subscriber& subscriber);
+    void erasePending(void);
+    Subscriber* findSubscriber(std::string_view key);
+    void removeSubscriber(const std::string& key);
+    void addTask(const std::string& key, Subscriber& subscriber);
+
+    bool startNotify(void);
+    void stopNotify(void);
+    void waitNotify(void);
+    void handleNotify(void);
+    void postNotify(void);
+    void notifyAll(void);
+};
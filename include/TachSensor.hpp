@@ -1,4 +1,6 @@
 #pragma once
+#include "PresenceManager.hpp"
+#include "SensorSnapshot.hpp"
 #include "Thresholds.hpp"
 #include "sensor.hpp"
 
@@ -6,7 +8,7 @@
 
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
-#include <gpiod.hpp>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <sdbusplus/asio/object_server.hpp>
@@ -14,6 +16,7 @@
 #include <utility>
 #include <vector>
 
+// Presence pin of a fan, watched by the PresenceManager
 class PresenceSensor
 {
   public:
@@ -21,16 +24,18 @@ class PresenceSensor
                    boost::asio::io_service& io, const std::string& name);
     ~PresenceSensor();
 
-    void monitorPresence(void);
-    void read(void);
     bool getValue(void);
+    // runs when the fan is inserted or removed
+    void onChange(std::function<void(bool present)>&& callback);
+    // called by the PresenceManager with the level of the pin, edge is set
+    // when it was read because of an edge rather than at startup
+    void update(bool present, bool edge);
 
   private:
+    PresenceManager& manager;
     bool status = true;
-    bool inverted;
-    gpiod::line gpioLine;
-    boost::asio::posix::stream_descriptor gpioFd;
     std::string name;
+    std::function<void(bool present)> changed;
 };
 
 namespace redundancy
@@ -40,23 +45,33 @@ constexpr const char* degraded = "Degraded";
 constexpr const char* failed = "Failed";
 } // namespace redundancy
 
+// One fan redundancy group, published at
+// /xyz/openbmc_project/control/FanRedundancy/<name>. Children are fan_tach
+// object paths and are addressed by their index in the collection, resolved
+// once when a TachSensor joins. The failed count only moves when a child
+// changes state, so an update is O(1) whatever the size of the group.
 class RedundancySensor
 {
   public:
-    RedundancySensor(size_t count, const std::vector<std::string>& children,
+    RedundancySensor(const std::string& name, size_t count,
+                     const std::vector<std::string>& children,
                      sdbusplus::asio::object_server& objectServer,
                      const std::string& sensorConfiguration);
     ~RedundancySensor();
 
-    void update(const std::string& name, bool failed);
+    // index of the child for the tach sensor named sensorName
+    std::optional<size_t> findChild(const std::string& sensorName) const;
+    void update(size_t child, bool failed);
 
   private:
     size_t count;
-    std::string state = redundancy::full;
+    size_t failedCount = 0;
+    const char* state = redundancy::full;
+    std::vector<std::string> children;
+    std::vector<bool> failures;
     std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> association;
     sdbusplus::asio::object_server& objectServer;
-    boost::container::flat_map<std::string, bool> statuses;
 };
 
 class TachSensor : public Sensor
@@ -66,26 +81,39 @@ class TachSensor : public Sensor
                sdbusplus::asio::object_server& objectServer,
                std::shared_ptr<sdbusplus::asio::connection>& conn,
                std::unique_ptr<PresenceSensor>&& presence,
-               std::optional<RedundancySensor>* redundancy,
                boost::asio::io_service& io, const std::string& fanName,
                std::vector<thresholds::Threshold>&& thresholds,
                const std::string& sensorConfiguration,
-               const std::pair<size_t, size_t>& limits);
+               const std::pair<size_t, size_t>& limits,
+               unsigned int pollRateMs = defaultPollMs);
     ~TachSensor();
 
+    static constexpr unsigned int defaultPollMs = 500;
+
+    // reports to group from now on, false if this fan is not in it
+    bool joinRedundancy(RedundancySensor& group);
+
   private:
+    struct RedundancyMember
+    {
+        RedundancySensor* group;
+        size_t child;
+    };
+
     sdbusplus::asio::object_server& objServer;
-    std::optional<RedundancySensor>* redundancy;
+    std::vector<RedundancyMember> redundancy;
+    // failed as last reported to the redundancy groups
+    bool redundancyFailed = false;
     std::unique_ptr<PresenceSensor> presence;
     std::shared_ptr<sdbusplus::asio::dbus_interface> itemIface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> itemAssoc;
-    boost::asio::posix::stream_descriptor inputDev;
-    boost::asio::deadline_timer waitTimer;
-    boost::asio::streambuf readBuf;
+    std::shared_ptr<SensorSnapshot> snapshot;
     std::string path;
     size_t errCount;
+    unsigned int pollRateMs;
     void setupRead(void);
-    void handleResponse(const boost::system::error_code& err);
+    void handleResponse(const boost::system::error_code& err,
+                        const std::optional<double>& reading);
     void checkThresholds(void) override;
 };
 
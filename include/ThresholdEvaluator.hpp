@@ -0,0 +1,36 @@
+#pragma once
+
+#include "SensorRegistry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Threshold checks over the values and thresholds packed in SensorRegistry.
+// Every threshold slot of a sensor is compared at once, HIGH slots assert at
+// or above the threshold and clear below it minus the trigger hysteresis, LOW
+// slots the other way round, and the results are folded into masks against
+// the asserted alarm bits instead of branching per threshold. A NaN value or
+// an unset (NaN) threshold compares false both ways and leaves its bit alone.
+// Nothing is allocated and the registry is not modified, callers assert or
+// deassert the bits that come back.
+namespace thresholds
+{
+// alarm bits of id that would change with its current value
+uint8_t evaluate(const SensorRegistry& registry, SensorRegistry::SensorId id);
+// same against alarms instead of the asserted bits, for callers that treat
+// alarms still pending as asserted
+uint8_t evaluate(const SensorRegistry& registry, SensorRegistry::SensorId id,
+                 uint8_t alarms);
+
+// writes the transitions of ids[ii] to transitions[ii], returns them or'ed
+// together so a batch without any change is skipped with one test. Pending
+// alarms count as asserted, as they do for checkThresholdsPowerDelay.
+uint8_t evaluate(const SensorRegistry& registry,
+                 const SensorRegistry::SensorId* ids, size_t count,
+                 uint8_t* transitions);
+
+// same for the contiguous ids first to first + count - 1
+uint8_t evaluateRange(const SensorRegistry& registry,
+                      SensorRegistry::SensorId first, size_t count,
+                      uint8_t* transitions);
+} // namespace thresholds
@@ -1,8 +1,12 @@
 #pragma once
+#include "SensorRegistry.hpp"
 #include "Utils.hpp"
 
+#include <array>
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
-#include <list>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <string>
@@ -42,62 +46,124 @@ struct Threshold
     }
 };
 
+// index of a threshold in SensorRegistry::thresholdValues and of its bit in
+// SensorRegistry::alarms: warning high, warning low, critical high, critical
+// low
+constexpr size_t slot(Level level, Direction direction)
+{
+    return static_cast<size_t>(level) * 2 + static_cast<size_t>(direction);
+}
+
+constexpr uint8_t alarmBit(Level level, Direction direction)
+{
+    return static_cast<uint8_t>(1U << slot(level, direction));
+}
+
+// threshold and alarm property names of each slot on the Warning or Critical
+// threshold interface
+constexpr std::array<const char*, 4> thresholdProperties = {
+    "WarningHigh", "WarningLow", "CriticalHigh", "CriticalLow"};
+constexpr std::array<const char*, 4> alarmProperties = {
+    "WarningAlarmHigh", "WarningAlarmLow", "CriticalAlarmHigh",
+    "CriticalAlarmLow"};
+
 void assertThresholds(Sensor* sensor, thresholds::Level level,
                       thresholds::Direction direction, bool assert);
 
-using TimerPair = std::pair<bool, boost::asio::deadline_timer>;
+class ThresholdTimerQueue;
 
+// Power-on delay of the alarms of one sensor. Each level and direction has
+// one fixed entry that is either idle or linked into the ThresholdTimerQueue
+// shared by all sensors, so starting a pending threshold again is a no-op
+// and nothing is allocated however often a threshold flaps.
 struct ThresholdTimer
 {
-
-    ThresholdTimer(boost::asio::io_service& ioService, Sensor* sensor) :
-        io(ioService), sensor(sensor)
+    ThresholdTimer(boost::asio::io_service& ioService, Sensor* sensor);
+    ~ThresholdTimer();
+    ThresholdTimer(const ThresholdTimer&) = delete;
+    ThresholdTimer& operator=(const ThresholdTimer&) = delete;
+
+    // asserts the threshold once the delay passes with the host powered on
+    void startTimer(const Threshold& threshold);
+    void stopTimer(Level level, Direction direction);
+    // alarmBit() of every threshold with a timer running
+    uint8_t getPending(void) const
     {
+        return pending;
     }
 
-    void startTimer(const Threshold& threshold)
+    struct Entry
     {
-        constexpr const size_t waitTime = 5;
-        TimerPair* pair = nullptr;
-
-        for (TimerPair& timer : timers)
-        {
-            if (!timer.first)
-            {
-                pair = &timer;
-                break;
-            }
-        }
-        if (pair == nullptr)
-        {
-            pair = &timers.emplace_back(false, boost::asio::deadline_timer(io));
-        }
-        pair->first = true;
-        pair->second.expires_from_now(boost::posix_time::seconds(waitTime));
-        pair->second.async_wait(
-            [this, pair, threshold](boost::system::error_code ec) {
-                pair->first = false;
-
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    return; // we're being canceled
-                }
-                else if (ec)
-                {
-                    std::cerr << "timer error: " << ec.message() << "\n";
-                    return;
-                }
-                if (isPowerOn())
-                {
-                    assertThresholds(sensor, threshold.level,
-                                     threshold.direction, true);
-                }
-            });
-    }
+        ThresholdTimer* owner = nullptr;
+        Level level = Level::WARNING;
+        Direction direction = Direction::HIGH;
+        boost::posix_time::ptime deadline;
+        Entry* prev = nullptr;
+        Entry* next = nullptr;
+    };
+
+    ThresholdTimerQueue& queue;
+    Sensor* sensor;
+    std::array<Entry, 4> entries;
+    uint8_t pending = 0;
+
+    // keeps the registry's copy of pending in step for batch checks
+    void setPending(uint8_t bits);
+};
+
+// One deadline_timer for every ThresholdTimer. All timers run for the same
+// delay, so appending keeps the list in deadline order and the timer only
+// ever waits for the head.
+class ThresholdTimerQueue
+{
+  public:
+    static constexpr unsigned int waitTimeS = 5;
+
+    static ThresholdTimerQueue& get(boost::asio::io_service& io);
 
+    ThresholdTimerQueue(const ThresholdTimerQueue&) = delete;
+    ThresholdTimerQueue& operator=(const ThresholdTimerQueue&) = delete;
+
+    void push(ThresholdTimer::Entry& entry);
+    void erase(ThresholdTimer::Entry& entry);
+
+  private:
+    explicit ThresholdTimerQueue(boost::asio::io_service& io);
+
+    boost::asio::deadline_timer timer;
+    ThresholdTimer::Entry* head = nullptr;
+    ThresholdTimer::Entry* tail = nullptr;
+
+    void arm(void);
+    void expire(void);
+};
+
+// Threshold checks of the sensors whose value changed in one tick. Their ids
+// are collected instead of each sensor checking from updateValue, once the
+// handler that updated them returned they are evaluated together in one pass
+// over the registry and only the sensors with a transition run their
+// checkThresholds to assert, deassert or time their alarms.
+class ThresholdChecker
+{
+  public:
+    static ThresholdChecker& create(boost::asio::io_service& io);
+    // nullptr until created, sensors then check immediately
+    static ThresholdChecker* get(void);
+
+    ThresholdChecker(const ThresholdChecker&) = delete;
+    ThresholdChecker& operator=(const ThresholdChecker&) = delete;
+
+    void add(SensorRegistry::SensorId id);
+
+  private:
     boost::asio::io_service& io;
-    std::list<TimerPair> timers;
-    Sensor* sensor;
+    std::vector<SensorRegistry::SensorId> dirty;
+    std::vector<SensorRegistry::SensorId> checking;
+    std::vector<uint8_t> transitions;
+    bool checkPending = false;
+
+    explicit ThresholdChecker(boost::asio::io_service& io);
+    void check(void);
 };
 
 bool parseThresholdsFromConfig(
@@ -121,7 +187,8 @@ void persistThreshold(const std::string& baseInterface, const std::string& path,
                       size_t thresholdCount, const std::string& label);
 
 void updateThresholds(Sensor* sensor);
-// returns false if a critical threshold has been crossed, true otherwise
+// asserts and deasserts the alarms whose state changed with the current value,
+// returns false while a critical threshold is asserted, true otherwise
 bool checkThresholds(Sensor* sensor);
 void checkThresholdsPowerDelay(Sensor* sensor, ThresholdTimer& thresholdTimer);
 
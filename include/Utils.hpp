@@ -3,6 +3,8 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/container/flat_map.hpp>
+#include <chrono>
+#include <deque>
 #include <filesystem>
 #include <functional>
 #include <iostream>
@@ -26,8 +28,9 @@ constexpr const char* cpuInventoryPath =
 const std::regex illegalDbusRegex("[^A-Za-z0-9_]");
 
 using BasicVariantType =
-    std::variant<std::vector<std::string>, std::string, int64_t, uint64_t,
-                 double, int32_t, uint32_t, int16_t, uint16_t, uint8_t, bool>;
+    std::variant<std::vector<std::string>, std::vector<double>, std::string,
+                 int64_t, uint64_t, double, int32_t, uint32_t, int16_t,
+                 uint16_t, uint8_t, bool>;
 using SensorBaseConfigMap =
     boost::container::flat_map<std::string, BasicVariantType>;
 using SensorBaseConfiguration = std::pair<std::string, SensorBaseConfigMap>;
@@ -47,6 +50,9 @@ bool findFiles(const std::filesystem::path dirPath,
 bool isPowerOn(void);
 bool hasBiosPost(void);
 void setupPowerMatch(const std::shared_ptr<sdbusplus::asio::connection>& conn);
+// served from ConfigCache, blocks on a GetManagedObjects only while the cache
+// has not been loaded yet. useCache is kept for callers, the cache follows
+// EntityManager's changes on its own.
 bool getSensorConfiguration(
     const std::string& type,
     const std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
@@ -60,6 +66,12 @@ void createAssociation(
 void findLimits(std::pair<double, double>& limits,
                 const SensorBaseConfiguration* data);
 
+// poll period from the PollRate (in seconds) of a sensor configuration,
+// bounded to 10 ms up to an hour, defaultMs if it is missing, not a number
+// or not positive
+unsigned int getPollRate(const SensorBaseConfigMap& baseConfig,
+                         unsigned int defaultMs);
+
 enum class PowerState
 {
     on,
@@ -155,78 +167,53 @@ void createInventoryAssoc(
     std::shared_ptr<sdbusplus::asio::dbus_interface> association,
     const std::string& path);
 
+// Reads the configuration objects implementing any of the given interface
+// prefixes and hands them to the callback once every reply arrived. Requests
+// are grouped by owning service and each owner is asked once for all its
+// objects with GetManagedObjects, falling back to a GetAll per object and
+// interface for owners without an ObjectManager at the root. At most
+// maxInFlight calls are outstanding at any time.
 struct GetSensorConfiguration
     : std::enable_shared_from_this<GetSensorConfiguration>
 {
+    static constexpr size_t defaultMaxInFlight = 8;
+
     GetSensorConfiguration(
         std::shared_ptr<sdbusplus::asio::connection> connection,
-        std::function<void(ManagedObjectType& resp)>&& callbackFunc) :
+        std::function<void(ManagedObjectType& resp)>&& callbackFunc,
+        size_t maxInFlight = defaultMaxInFlight) :
         dbusConnection(connection),
-        callback(std::move(callbackFunc))
-    {
-    }
-    void getConfiguration(const std::vector<std::string>& interfaces)
+        callback(std::move(callbackFunc)), maxInFlight(maxInFlight)
     {
-        std::shared_ptr<GetSensorConfiguration> self = shared_from_this();
-        dbusConnection->async_method_call(
-            [self, interfaces](const boost::system::error_code ec,
-                               const GetSubTreeType& ret) {
-                if (ec)
-                {
-                    std::cerr << "Error calling mapper\n";
-                    return;
-                }
-                for (const auto& [path, objDict] : ret)
-                {
-                    if (objDict.empty())
-                    {
-                        return;
-                    }
-                    const std::string& owner = objDict.begin()->first;
-
-                    for (const std::string& interface : objDict.begin()->second)
-                    {
-                        // anything that starts with a requested configuration
-                        // is good
-                        if (std::find_if(
-                                interfaces.begin(), interfaces.end(),
-                                [interface](const std::string& possible) {
-                                    return boost::starts_with(interface,
-                                                              possible);
-                                }) == interfaces.end())
-                        {
-                            continue;
-                        }
-
-                        self->dbusConnection->async_method_call(
-                            [self, path, interface](
-                                const boost::system::error_code ec,
-                                boost::container::flat_map<
-                                    std::string, BasicVariantType>& data) {
-                                if (ec)
-                                {
-                                    std::cerr << "Error getting " << path
-                                              << "\n";
-                                    return;
-                                }
-                                self->respData[path][interface] =
-                                    std::move(data);
-                            },
-                            owner, path, "org.freedesktop.DBus.Properties",
-                            "GetAll", interface);
-                    }
-                }
-            },
-            mapper::busName, mapper::path, mapper::interface, mapper::subtree,
-            "/", 0, interfaces);
     }
+    void getConfiguration(const std::vector<std::string>& interfaces);
 
-    ~GetSensorConfiguration()
-    {
-        callback(respData);
-    }
+    ~GetSensorConfiguration();
 
     std::shared_ptr<sdbusplus::asio::connection> dbusConnection;
     std::function<void(ManagedObjectType& resp)> callback;
     ManagedObjectType respData;
+
+  private:
+    // object path and interface
+    using Target = std::pair<std::string, std::string>;
+    struct Request
+    {
+        std::string owner;
+        std::vector<Target> targets;
+        // GetManagedObjects for all targets, else GetAll for the only one
+        bool managed;
+    };
+
+    size_t maxInFlight;
+    size_t inFlight = 0;
+    std::deque<Request> queue;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point mapperDone;
+    size_t managedCalls = 0;
+    size_t getAllCalls = 0;
+
+    void dispatch(void);
+    void send(Request&& request);
+    void done(void);
 };
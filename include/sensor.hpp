@@ -1,7 +1,12 @@
 #pragma once
 
+#include "SensorPublisher.hpp"
+#include "SensorRegistry.hpp"
 #include "Thresholds.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <sdbusplus/asio/object_server.hpp>
@@ -26,12 +31,21 @@ struct Sensor
         name(name),
         configurationPath(configurationPath), objectType(objectType),
         maxValue(max), minValue(min), thresholds(std::move(thresholdData)),
-        hysteresisTrigger((max - min) * 0.01),
-        hysteresisPublish((max - min) * 0.0001),
-        unit(unit)
+        unit(unit), id(SensorRegistry::get().add(this))
     {
+        SensorRegistry& registry = SensorRegistry::get();
+        registry.hysteresisTrigger[id] = (max - min) * 0.01;
+        registry.hysteresisPublish[id] = (max - min) * 0.0001;
+        syncThresholds();
+    }
+    virtual ~Sensor()
+    {
+        SensorRegistry::get().remove(id);
+        if (publishPending)
+        {
+            SensorPublisher::get()->remove(this);
+        }
     }
-    virtual ~Sensor() = default;
     virtual void checkThresholds(void) = 0;
     std::string name;
     std::string configurationPath;
@@ -44,11 +58,123 @@ struct Sensor
     std::shared_ptr<sdbusplus::asio::dbus_interface> thresholdInterfaceWarning;
     std::shared_ptr<sdbusplus::asio::dbus_interface> thresholdInterfaceCritical;
     std::shared_ptr<sdbusplus::asio::dbus_interface> association;
-    double value = std::numeric_limits<double>::quiet_NaN();
     bool overriddenState = false;
     bool internalSet = false;
-    double hysteresisTrigger;
-    double hysteresisPublish;
+    // set while the value waits in the publish stage
+    bool publishPending = false;
+    // index of the hot state kept in SensorRegistry
+    SensorRegistry::SensorId id;
+    // where each threshold slot's alarm is published, resolved once by
+    // setInitialProperties, a null interface for slots without a threshold
+    struct AlarmProperty
+    {
+        std::shared_ptr<sdbusplus::asio::dbus_interface> interface;
+        std::string name;
+    };
+    std::array<AlarmProperty, SensorRegistry::thresholdSlots> alarmProperties;
+    // adaptive polling, off until setPollLimits() gives a min below the max
+    unsigned int pollMinMs = 0;
+    unsigned int pollMaxMs = 0;
+    double pollMargin = 0;
+    double lastPollValue = std::numeric_limits<double>::quiet_NaN();
+
+    double& value(void)
+    {
+        return SensorRegistry::get().values[id];
+    }
+
+    double hysteresisTrigger(void) const
+    {
+        return SensorRegistry::get().hysteresisTrigger[id];
+    }
+
+    double hysteresisPublish(void) const
+    {
+        return SensorRegistry::get().hysteresisPublish[id];
+    }
+
+    // copies threshold values into the registry, has to follow every change
+    // to thresholds
+    void syncThresholds(void)
+    {
+        SensorRegistry& registry = SensorRegistry::get();
+        for (std::vector<double>& slot : registry.thresholdValues)
+        {
+            slot[id] = std::numeric_limits<double>::quiet_NaN();
+        }
+        for (const auto& threshold : thresholds)
+        {
+            registry.thresholdValues[thresholds::slot(
+                threshold.level, threshold.direction)][id] = threshold.value;
+        }
+    }
+
+    // lets the poll period float between minMs and maxMs, it is pinned to
+    // minMs while the value is within marginPercent of the range from any
+    // threshold
+    void setPollLimits(unsigned int minMs, unsigned int maxMs,
+                       double marginPercent)
+    {
+        pollMinMs = std::min(minMs, maxMs);
+        pollMaxMs = maxMs;
+        pollMargin = (maxValue - minValue) * marginPercent / 100;
+    }
+
+    // called once per sample, returns true when pollMs was changed. Stable
+    // readings double the period up to the max, a change beyond the trigger
+    // hysteresis halves it and keeps it short enough to take several samples
+    // before the nearest threshold could be reached at the current rate.
+    bool adaptPollRate(unsigned int& pollMs)
+    {
+        if (pollMinMs >= pollMaxMs)
+        {
+            return false;
+        }
+
+        double value = this->value();
+        double distance = std::numeric_limits<double>::infinity();
+        if (!std::isnan(value))
+        {
+            for (const auto& threshold : thresholds)
+            {
+                distance =
+                    std::min(distance, std::abs(value - threshold.value));
+            }
+        }
+
+        unsigned int next = pollMs;
+        if (std::isnan(value) || std::isnan(lastPollValue) ||
+            distance <= pollMargin)
+        {
+            next = pollMinMs;
+        }
+        else
+        {
+            double step = std::abs(value - lastPollValue);
+            if (step > hysteresisTrigger())
+            {
+                next = pollMs / 2;
+                double reachMs = distance / step * pollMs;
+                if (reachMs / 4 < next)
+                {
+                    next = static_cast<unsigned int>(reachMs / 4);
+                }
+            }
+            else
+            {
+                next = pollMs * 2;
+            }
+        }
+        lastPollValue = value;
+
+        next = std::clamp(next, pollMinMs, pollMaxMs);
+        if (next == pollMs)
+        {
+            return false;
+        }
+        pollMs = next;
+        return true;
+    }
 
     int setSensorValue(const double& newValue, double& oldValue)
     {
@@ -57,7 +183,7 @@ struct Sensor
             oldValue = newValue;
             overriddenState = true;
             // check thresholds for external set
-            value = newValue;
+            value() = newValue;
             checkThresholds();
         }
         else if (!overriddenState)
@@ -78,41 +204,19 @@ struct Sensor
         sensorInterface->register_property("MaxValue", maxValue);
         sensorInterface->register_property("MinValue", minValue);
         sensorInterface->register_property(
-            "Value", value, [&](const double& newValue, double& oldValue) {
+            "Value", value(), [&](const double& newValue, double& oldValue) {
                 return setSensorValue(newValue, oldValue);
             });
         for (auto& threshold : thresholds)
         {
             std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
-            std::string level;
-            std::string alarm;
             if (threshold.level == thresholds::Level::CRITICAL)
             {
                 iface = thresholdInterfaceCritical;
-                if (threshold.direction == thresholds::Direction::HIGH)
-                {
-                    level = "CriticalHigh";
-                    alarm = "CriticalAlarmHigh";
-                }
-                else
-                {
-                    level = "CriticalLow";
-                    alarm = "CriticalAlarmLow";
-                }
             }
             else if (threshold.level == thresholds::Level::WARNING)
             {
                 iface = thresholdInterfaceWarning;
-                if (threshold.direction == thresholds::Direction::HIGH)
-                {
-                    level = "WarningHigh";
-                    alarm = "WarningAlarmHigh";
-                }
-                else
-                {
-                    level = "WarningLow";
-                    alarm = "WarningAlarmLow";
-                }
             }
             else
             {
@@ -126,20 +230,23 @@ struct Sensor
                 continue;
             }
 
+            size_t slot =
+                thresholds::slot(threshold.level, threshold.direction);
             size_t thresSize =
                 label.empty() ? thresholds.size() : thresholdSize;
             iface->register_property(
-                level, threshold.value,
+                thresholds::thresholdProperties[slot], threshold.value,
                 [&, label, thresSize](const double& request, double& oldValue) {
                     oldValue = request; // todo, just let the config do this?
                     threshold.value = request;
+                    syncThresholds();
                     thresholds::persistThreshold(configurationPath, objectType,
                                                  threshold, conn, thresSize,
                                                  label);
                     // Invalidate previously remembered value,
                     // so new thresholds will be checked during next update,
                     // even if sensor reading remains unchanged.
-                    value = std::numeric_limits<double>::quiet_NaN();
+                    value() = std::numeric_limits<double>::quiet_NaN();
 
                     // Although tempting, don't call checkThresholds() from here
                     // directly. Let the regular sensor monitor call the same
@@ -147,7 +254,9 @@ struct Sensor
                     // poweron, etc., before raising any event.
                     return 1;
                 });
-            iface->register_property(alarm, false);
+            alarmProperties[slot].interface = iface;
+            alarmProperties[slot].name = thresholds::alarmProperties[slot];
+            iface->register_property(alarmProperties[slot].name, false);
         }
         if (!sensorInterface->initialize())
         {
@@ -166,6 +275,30 @@ struct Sensor
         }
     }
 
+    void publishValue(void)
+    {
+        publishPending = false;
+        // Indicate that it is internal set call
+        internalSet = true;
+        if (!(sensorInterface->set_property("Value", value())))
+        {
+            std::cerr << "error setting property to " << value() << "\n";
+        }
+        internalSet = false;
+        SensorRegistry::get().touch(id);
+    }
+
+    // signals a Value still held by the publish stage now, so an alarm is
+    // never seen before the reading that raised it
+    void flushValue(void)
+    {
+        if (publishPending)
+        {
+            SensorPublisher::get()->remove(this);
+            publishValue();
+        }
+    }
+
     void updateValue(const double& newValue)
     {
         // Ignore if overriding is enabled
@@ -174,6 +307,8 @@ struct Sensor
             return;
         }
 
+        SensorRegistry& registry = SensorRegistry::get();
+        double& value = registry.values[id];
         bool isChanged = false;
 
         // Avoid floating-point equality comparison,
@@ -191,7 +326,7 @@ struct Sensor
             // This essentially does "if (value != newValue)",
             // but safely against floating-point background noise.
             double diff = std::abs(value - newValue);
-            if (diff > hysteresisPublish)
+            if (diff > registry.hysteresisPublish[id])
             {
                 isChanged = true;
             }
@@ -204,21 +339,38 @@ struct Sensor
         }
 
         // The value will be changed, keep track of it for next time
+        registry.lastValues[id] = value;
         value = newValue;
 
-        // Indicate that it is internal set call
-        internalSet = true;
-        if (!(sensorInterface->set_property("Value", newValue)))
+        // Let the publish stage signal it together with the other sensors
+        // updated in this tick, the latest value wins if it changes again
+        SensorPublisher* publisher = SensorPublisher::get();
+        if (publisher == nullptr)
         {
-            std::cerr << "error setting property to " << newValue << "\n";
+            publishValue();
+        }
+        else if (!publishPending)
+        {
+            publishPending = true;
+            publisher->add(this);
         }
-        internalSet = false;
 
         // Always check thresholds after changing the value,
         // as the test against hysteresisTrigger now takes place in
         // the thresholds::checkThresholds() method,
         // which is called by checkThresholds() below,
         // in all current implementations of sensors that have thresholds.
-        checkThresholds();
+        // The checker evaluates every sensor changed in this tick together
+        // and calls checkThresholds() only on those with a transition.
+        thresholds::ThresholdChecker* checker =
+            thresholds::ThresholdChecker::get();
+        if (checker == nullptr)
+        {
+            checkThresholds();
+        }
+        else
+        {
+            checker->add(id);
+        }
     }
 };
@@ -33,7 +33,6 @@
 #include <string>
 #include <vector>
 
-static constexpr unsigned int sensorPollMs = 500;
 static constexpr size_t warnAfterErrorCount = 10;
 static constexpr unsigned int gpioBridgeEnableMs = 20;
 // scaling factor from hwmon
@@ -50,16 +49,17 @@ ADCSensor::ADCSensor(const std::string& path,
                      std::vector<thresholds::Threshold>&& _thresholds,
                      const double scaleFactor, PowerState readState,
                      const std::string& sensorConfiguration,
-                     std::optional<BridgeGpio>&& bridgeGpio) :
+                     std::optional<BridgeGpio>&& bridgeGpio,
+                     unsigned int pollRateMs) :
     Sensor(boost::replace_all_copy(sensorName, " ", "_"),
            std::move(_thresholds), sensorConfiguration,
            "xyz.openbmc_project.Configuration.ADC", maxReading, minReading,
             sdbusplus::xyz::openbmc_project::Sensor::server::Value::Unit::Volts
     ),
-    objServer(objectServer), inputDev(io, open(path.c_str(), O_RDONLY)),
-    waitTimer(io), path(path), errCount(0), scaleFactor(scaleFactor),
+    objServer(objectServer), snapshot(SensorSnapshot::getSnapshot(io, path)),
+    path(path), errCount(0), scaleFactor(scaleFactor),
     bridgeGpio(std::move(bridgeGpio)), readState(std::move(readState)),
-    thresholdTimer(io, this)
+    pollRateMs(pollRateMs), thresholdTimer(io, this)
 {
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/voltage/" + name,
@@ -87,9 +87,7 @@ ADCSensor::ADCSensor(const std::string& path,
 
 ADCSensor::~ADCSensor()
 {
-    // close the input dev to cancel async operations
-    inputDev.close();
-    waitTimer.cancel();
+    snapshot->unsubscribe(name, this);
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
@@ -122,49 +120,29 @@ void ADCSensor::setupRead(void)
     else
     */
     {
-        boost::asio::async_read_until(
-            inputDev, readBuf, '\n',
-            [&](const boost::system::error_code& ec,
-                std::size_t /*bytes_transfered*/) { handleResponse(ec); });
+        snapshot->subscribe(name, this, pollRateMs,
+                            [this](const boost::system::error_code& ec,
+                                   const std::optional<double>& reading) {
+                                handleResponse(ec, reading);
+                            });
     }
 }
 
-void ADCSensor::handleResponse(const boost::system::error_code& err)
+void ADCSensor::handleResponse(const boost::system::error_code& err,
+                               const std::optional<double>& reading)
 {
-    if (err == boost::system::errc::bad_file_descriptor)
-    {
-        return; // we're being destroyed
-    }
-    std::istream responseStream(&readBuf);
-
     if (!err)
     {
-        std::string response;
         // todo read scaling factors from configuration
-        try
+        if (reading)
         {
-            std::string line;
-            while (std::getline(responseStream, line))
-            {
-                std::string key{""}, value{""};
-                std::istringstream kv(line);
-                std::getline(kv, key, '=');
-                std::getline(kv, value);
-                if (this->name == key) {
-                    response = value;
-                }
-            }
-
-
-            double nvalue = std::stod(response);
-
-            nvalue = (nvalue / sensorScaleFactor) / scaleFactor;
+            double nvalue = (*reading / sensorScaleFactor) / scaleFactor;
             nvalue = std::round(nvalue * roundFactor) / roundFactor;
 
             updateValue(nvalue);
             errCount = 0;
         }
-        catch (std::invalid_argument&)
+        else
         {
             errCount++;
         }
@@ -190,26 +168,15 @@ void ADCSensor::handleResponse(const boost::system::error_code& err)
         updateValue(0);
     }
 
-    responseStream.clear();
-    inputDev.close();
+    if (adaptPollRate(pollRateMs))
+    {
+        snapshot->setPollRate(name, this, pollRateMs);
+    }
+
     //if (bridgeGpio.has_value())
     //{
     //    (*bridgeGpio).set(0);
     //}
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
-    {
-        return; // we're no longer valid
-    }
-    inputDev.assign(fd);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(sensorPollMs));
-    waitTimer.async_wait([&](const boost::system::error_code& ec) {
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            return; // we're being canceled
-        }
-        setupRead();
-    });
 }
 
 void ADCSensor::checkThresholds(void)
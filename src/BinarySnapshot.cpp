@@ -0,0 +1,309 @@
+#include "BinarySnapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a producer holds the generation odd only for a few stores, give up after
+// this many attempts and report the slot as unreadable for this sample
+static constexpr size_t maxReadRetries = 64;
+
+size_t binsnapshot::fileSize(size_t slotCount)
+{
+    return sizeof(Header) + slotCount * nameSize + slotCount * sizeof(Slot);
+}
+
+static std::string_view slotName(const char* names, size_t index)
+{
+    const char* name = names + index * binsnapshot::nameSize;
+    return std::string_view(name, strnlen(name, binsnapshot::nameSize));
+}
+
+static std::optional<size_t> findName(const char* names, size_t count,
+                                      std::string_view name)
+{
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        if (slotName(names, ii) == name)
+        {
+            return ii;
+        }
+    }
+    return std::nullopt;
+}
+
+BinarySnapshotReader::~BinarySnapshotReader()
+{
+    close();
+}
+
+bool BinarySnapshotReader::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat fileInfo = {};
+    if (fstat(fd, &fileInfo) < 0 ||
+        static_cast<size_t>(fileInfo.st_size) < sizeof(binsnapshot::Header))
+    {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(fileInfo.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const auto* mappedHeader = static_cast<const binsnapshot::Header*>(mapped);
+    if (mappedHeader->magic != binsnapshot::magic)
+    {
+        // a text source
+        munmap(mapped, size);
+        return false;
+    }
+    if (mappedHeader->version != binsnapshot::version ||
+        mappedHeader->nameSize != binsnapshot::nameSize ||
+        mappedHeader->namesOffset + mappedHeader->slotCount *
+                                        binsnapshot::nameSize > size ||
+        mappedHeader->slotsOffset + mappedHeader->slotCount *
+                                        sizeof(binsnapshot::Slot) > size ||
+        mappedHeader->slotsOffset % alignof(binsnapshot::Slot) != 0)
+    {
+        std::cerr << "Unsupported binary sensor snapshot " << path << "\n";
+        munmap(mapped, size);
+        return false;
+    }
+
+    map = mapped;
+    mapSize = size;
+    device = fileInfo.st_dev;
+    inode = fileInfo.st_ino;
+    header = mappedHeader;
+    names = static_cast<const char*>(mapped) + header->namesOffset;
+    slots = reinterpret_cast<const binsnapshot::Slot*>(
+        static_cast<const char*>(mapped) + header->slotsOffset);
+    return true;
+}
+
+void BinarySnapshotReader::close(void)
+{
+    if (map != nullptr)
+    {
+        munmap(map, mapSize);
+    }
+    map = nullptr;
+    mapSize = 0;
+    header = nullptr;
+    names = nullptr;
+    slots = nullptr;
+}
+
+bool BinarySnapshotReader::replaced(const std::string& path) const
+{
+    struct stat fileInfo = {};
+    if (stat(path.c_str(), &fileInfo) < 0)
+    {
+        return false;
+    }
+    return fileInfo.st_dev != device || fileInfo.st_ino != inode;
+}
+
+std::optional<size_t>
+    BinarySnapshotReader::findSlot(std::string_view name) const
+{
+    if (header == nullptr)
+    {
+        return std::nullopt;
+    }
+    return findName(names, header->slotCount, name);
+}
+
+uint64_t BinarySnapshotReader::getGeneration(void) const
+{
+    if (header == nullptr)
+    {
+        return 0;
+    }
+    return __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE);
+}
+
+bool BinarySnapshotReader::readSlot(size_t index,
+                                    binsnapshot::Slot& slot) const
+{
+    if (header == nullptr || index >= header->slotCount)
+    {
+        return false;
+    }
+    for (size_t attempt = 0; attempt < maxReadRetries; attempt++)
+    {
+        uint64_t before =
+            __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE);
+        if (before & 1)
+        {
+            continue;
+        }
+        std::memcpy(&slot, &slots[index], sizeof(slot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after =
+            __atomic_load_n(&header->generation, __ATOMIC_RELAXED);
+        if (before == after)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+BinarySnapshotWriter::~BinarySnapshotWriter()
+{
+    close();
+}
+
+void BinarySnapshotWriter::close(void)
+{
+    if (map != nullptr)
+    {
+        munmap(map, mapSize);
+    }
+    map = nullptr;
+    mapSize = 0;
+    header = nullptr;
+    names = nullptr;
+    slots = nullptr;
+}
+
+bool BinarySnapshotWriter::create(const std::string& path,
+                                  const std::vector<std::string>& slotNames)
+{
+    close();
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to create " << tmpPath << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+    size_t size = binsnapshot::fileSize(slotNames.size());
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0)
+    {
+        std::cerr << "Failed to size " << tmpPath << ": "
+                  << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    void* mapped =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        std::cerr << "Failed to map " << tmpPath << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    map = mapped;
+    mapSize = size;
+    header = static_cast<binsnapshot::Header*>(mapped);
+    char* nameTable = static_cast<char*>(mapped) + sizeof(binsnapshot::Header);
+    slots = reinterpret_cast<binsnapshot::Slot*>(
+        nameTable + slotNames.size() * binsnapshot::nameSize);
+    names = nameTable;
+
+    for (size_t ii = 0; ii < slotNames.size(); ii++)
+    {
+        // names longer than a table entry are cut, the file is zero filled
+        // so shorter ones stay terminated
+        std::memcpy(nameTable + ii * binsnapshot::nameSize,
+                    slotNames[ii].data(),
+                    std::min(slotNames[ii].size(), binsnapshot::nameSize));
+        slots[ii].value = 0;
+        slots[ii].status = binsnapshot::SlotStatus::unavailable;
+    }
+    header->version = binsnapshot::version;
+    header->headerSize = sizeof(binsnapshot::Header);
+    header->slotCount = static_cast<uint32_t>(slotNames.size());
+    header->nameSize = binsnapshot::nameSize;
+    header->namesOffset = sizeof(binsnapshot::Header);
+    header->slotsOffset =
+        sizeof(binsnapshot::Header) + slotNames.size() * binsnapshot::nameSize;
+    header->generation = 0;
+    header->magic = binsnapshot::magic;
+
+    // readers only see the file once it is complete
+    if (rename(tmpPath.c_str(), path.c_str()) < 0)
+    {
+        std::cerr << "Failed to replace " << path << ": "
+                  << std::strerror(errno) << "\n";
+        close();
+        return false;
+    }
+    return true;
+}
+
+std::optional<size_t>
+    BinarySnapshotWriter::findSlot(std::string_view name) const
+{
+    if (header == nullptr)
+    {
+        return std::nullopt;
+    }
+    return findName(names, header->slotCount, name);
+}
+
+void BinarySnapshotWriter::begin(void)
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+    uint64_t generation =
+        __atomic_load_n(&header->generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->generation, generation + 1, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void BinarySnapshotWriter::set(size_t index, double value,
+                               binsnapshot::SlotStatus status)
+{
+    if (header == nullptr || index >= header->slotCount)
+    {
+        return;
+    }
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    slots[index].value = value;
+    slots[index].timestampUs = static_cast<uint64_t>(now.tv_sec) * 1000000 +
+                               static_cast<uint64_t>(now.tv_nsec) / 1000;
+    slots[index].status = status;
+}
+
+void BinarySnapshotWriter::commit(void)
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+    uint64_t generation =
+        __atomic_load_n(&header->generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->generation, generation + 1, __ATOMIC_RELEASE);
+}
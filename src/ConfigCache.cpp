@@ -0,0 +1,315 @@
+#include "ConfigCache.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+static constexpr const char* objectManagerInterface =
+    "org.freedesktop.DBus.ObjectManager";
+static constexpr const char* propertiesInterface =
+    "org.freedesktop.DBus.Properties";
+// EntityManager may not be up yet when we start
+static constexpr unsigned int readRetryMs = 5000;
+
+ConfigCache::ConfigCache(
+    const std::shared_ptr<sdbusplus::asio::connection>& conn) :
+    conn(conn), retryTimer(conn->get_io_context())
+{
+    std::string sender = "type='signal',sender='" +
+                         std::string(entityManagerName) + "',interface='";
+    auto& bus = static_cast<sdbusplus::bus::bus&>(*conn);
+
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sender + objectManagerInterface + "',member='InterfacesAdded'",
+        [this](sdbusplus::message::message& message) {
+            sdbusplus::message::object_path path;
+            SensorData interfaces;
+            try
+            {
+                message.read(path, interfaces);
+            }
+            catch (const sdbusplus::exception::exception&)
+            {
+                stale = true;
+                read();
+                return;
+            }
+            addInterfaces(path.str, std::move(interfaces));
+        }));
+
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sender + objectManagerInterface + "',member='InterfacesRemoved'",
+        [this](sdbusplus::message::message& message) {
+            sdbusplus::message::object_path path;
+            std::vector<std::string> interfaces;
+            try
+            {
+                message.read(path, interfaces);
+            }
+            catch (const sdbusplus::exception::exception&)
+            {
+                stale = true;
+                read();
+                return;
+            }
+            removeInterfaces(path.str, interfaces);
+        }));
+
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus, sender + propertiesInterface + "',member='PropertiesChanged'",
+        [this](sdbusplus::message::message& message) {
+            std::string interface;
+            SensorBaseConfigMap values;
+            try
+            {
+                message.read(interface, values);
+            }
+            catch (const sdbusplus::exception::exception&)
+            {
+                stale = true;
+                read();
+                return;
+            }
+            changeProperties(message.get_path(), interface,
+                             std::move(values));
+        }));
+}
+
+ConfigCache&
+    ConfigCache::get(const std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    // never destroyed, the matches would outlive the connection otherwise
+    static ConfigCache* cache = new ConfigCache(conn);
+    return *cache;
+}
+
+void ConfigCache::load(std::function<void(void)>&& ready)
+{
+    if (loaded && !loading)
+    {
+        if (ready)
+        {
+            ready();
+        }
+        return;
+    }
+    if (ready)
+    {
+        readyCallbacks.emplace_back(std::move(ready));
+    }
+    read();
+}
+
+void ConfigCache::read(void)
+{
+    if (loading)
+    {
+        // the reply in flight may predate the change that got us here
+        stale = true;
+        return;
+    }
+    loading = true;
+    stale = false;
+    retryTimer.cancel();
+    conn->async_method_call(
+        [this](const boost::system::error_code ec,
+               ManagedObjectType& reply) {
+            loading = false;
+            if (ec)
+            {
+                // EntityManager may take a while to come up, only say so once
+                if (!readFailed)
+                {
+                    std::cerr << "Error reading configuration from "
+                              << entityManagerName << ", retrying\n";
+                    readFailed = true;
+                }
+                retryTimer.expires_from_now(
+                    boost::posix_time::milliseconds(readRetryMs));
+                retryTimer.async_wait(
+                    [this](const boost::system::error_code& ec) {
+                        if (ec == boost::asio::error::operation_aborted)
+                        {
+                            return;
+                        }
+                        read();
+                    });
+                return;
+            }
+            if (readFailed)
+            {
+                std::cerr << "Read configuration from " << entityManagerName
+                          << "\n";
+                readFailed = false;
+            }
+            if (stale)
+            {
+                read();
+                return;
+            }
+            bool reload = loaded;
+            ManagedObjectType previous;
+            if (reload)
+            {
+                previous = std::move(objects);
+            }
+            assign(std::move(reply));
+            if (reload)
+            {
+                // the objects gone since the last read changed as well
+                for (const auto& object : previous)
+                {
+                    if (objects.find(object.first) == objects.end())
+                    {
+                        changed(object.first.str);
+                    }
+                }
+                for (const auto& object : objects)
+                {
+                    changed(object.first.str);
+                }
+            }
+            std::vector<std::function<void(void)>> callbacks;
+            callbacks.swap(readyCallbacks);
+            for (const auto& callback : callbacks)
+            {
+                callback();
+            }
+        },
+        entityManagerName, "/", objectManagerInterface, "GetManagedObjects");
+}
+
+void ConfigCache::assign(ManagedObjectType&& newObjects)
+{
+    objects = std::move(newObjects);
+    loaded = true;
+    rebuildIndex();
+}
+
+void ConfigCache::rebuildIndex(void)
+{
+    byInterface.clear();
+    for (const auto& [path, interfaces] : objects)
+    {
+        for (const auto& interface : interfaces)
+        {
+            byInterface[interface.first].insert(path.str);
+        }
+    }
+}
+
+void ConfigCache::find(const std::string& type, ManagedObjectType& resp) const
+{
+    // interface names sharing the prefix type are adjacent in the index
+    for (auto it = byInterface.lower_bound(type);
+         it != byInterface.end() && boost::starts_with(it->first, type); it++)
+    {
+        for (const std::string& path : it->second)
+        {
+            auto object = objects.find(sdbusplus::message::object_path(path));
+            if (object != objects.end())
+            {
+                resp.emplace(*object);
+            }
+        }
+    }
+}
+
+void ConfigCache::onChange(ChangeCallback&& callback)
+{
+    changeCallbacks.emplace_back(std::move(callback));
+}
+
+void ConfigCache::addInterfaces(const std::string& path,
+                                SensorData&& interfaces)
+{
+    if (!loaded || loading)
+    {
+        read();
+        return;
+    }
+    SensorData& object = objects[sdbusplus::message::object_path(path)];
+    for (auto& [interface, values] : interfaces)
+    {
+        byInterface[interface].insert(path);
+        object[interface] = std::move(values);
+    }
+    changed(path);
+}
+
+void ConfigCache::removeInterfaces(const std::string& path,
+                                   const std::vector<std::string>& interfaces)
+{
+    if (!loaded || loading)
+    {
+        read();
+        return;
+    }
+    auto object = objects.find(sdbusplus::message::object_path(path));
+    if (object == objects.end())
+    {
+        return;
+    }
+    for (const std::string& interface : interfaces)
+    {
+        object->second.erase(interface);
+        auto indexed = byInterface.find(interface);
+        if (indexed != byInterface.end())
+        {
+            indexed->second.erase(path);
+            if (indexed->second.empty())
+            {
+                byInterface.erase(indexed);
+            }
+        }
+    }
+    if (object->second.empty())
+    {
+        objects.erase(object);
+    }
+    changed(path);
+}
+
+void ConfigCache::changeProperties(const std::string& path,
+                                   const std::string& interface,
+                                   SensorBaseConfigMap&& values)
+{
+    if (!loaded || loading)
+    {
+        read();
+        return;
+    }
+    auto object = objects.find(sdbusplus::message::object_path(path));
+    if (object == objects.end())
+    {
+        return;
+    }
+    auto properties = object->second.find(interface);
+    if (properties == object->second.end())
+    {
+        return;
+    }
+    std::vector<std::string> names;
+    names.reserve(values.size());
+    for (auto& [name, value] : values)
+    {
+        names.emplace_back(name);
+        properties->second[name] = std::move(value);
+    }
+    changed(path, interface, names);
+}
+
+void ConfigCache::changed(const std::string& path,
+                          const std::string& interface,
+                          const std::vector<std::string>& properties)
+{
+    for (const auto& callback : changeCallbacks)
+    {
+        callback(path, interface, properties);
+    }
+}
@@ -5,7 +5,15 @@
 #include "PSUSensor.hpp"
 #include "ADCSensor.hpp"
 #include "HwmonTempSensor.hpp"
-
+#include "FanControl.hpp"
+#include "PollScheduler.hpp"
+#include "SensorPublisher.hpp"
+#include "SensorConfig.hpp"
+#include "SensorRegistry.hpp"
+#include "SensorSnapshot.hpp"
+#include "ConfigCache.hpp"
+
+#include <algorithm>
 #include <array>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -24,7 +32,9 @@
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/server/manager.hpp>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -36,9 +46,13 @@ constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
 
 static constexpr bool DEBUG = false;
 
-static boost::container::flat_map<std::string, std::unique_ptr<PSUSensor>> psuSensors;
-static boost::container::flat_map<std::string, std::unique_ptr<ADCSensor>> adcSensors;
-static boost::container::flat_map<std::string, std::shared_ptr<HwmonTempSensor>> tempSensors;
+// adaptive polling limits for the sensors below
+static constexpr unsigned int minPollMs = 250;
+static constexpr unsigned int maxPollMs = 4000;
+static constexpr double pollMarginPercent = 10;
+// pwm Sets within the window are written once with the latest duty
+static constexpr unsigned int pwmWriteWindowMs = 10;
+
 
 void createTempSensors(boost::asio::io_service& io,
     sdbusplus::asio::object_server& objectServer,
@@ -56,14 +70,16 @@ void createTempSensors(boost::asio::io_service& io,
     sensorThresholds.emplace_back(t);
     const std::string interfacePath =
         "/xyz/openbmc_project/inventory/system/chassis/0";
-    auto& sensor = tempSensors[sensorName];
-    sensor = nullptr;
-    sensor = std::make_shared<HwmonTempSensor>(
+    // frees the name before the replacement subscribes and registers it
+    SensorRegistry::get().release(sensorName);
+    auto sensor = std::make_shared<HwmonTempSensor>(
                         sensorPath,
                         objectType, objectServer, dbusConnection, io,
                         sensorName, std::move(sensorThresholds),
                         interfacePath, PowerState::on);
+    sensor->setPollLimits(minPollMs, maxPollMs, pollMarginPercent);
     sensor->setupRead();
+    SensorRegistry::get().own(std::move(sensor));
 }
 
 void createADCSensors(boost::asio::io_service& io,
@@ -83,10 +99,14 @@ void createADCSensors(boost::asio::io_service& io,
     const std::string interfacePath =
         "/xyz/openbmc_project/inventory/system/chassis/0";
     std::optional<BridgeGpio> bridgeGpio;
-    adcSensors[sensorName] = std::make_unique<ADCSensor>(
+    // frees the name before the replacement subscribes and registers it
+    SensorRegistry::get().release(sensorName);
+    auto sensor = std::make_shared<ADCSensor>(
                     sensorPath, objectServer, dbusConnection, io, sensorName,
                     std::move(sensorThresholds), 1000, PowerState::on,
                     interfacePath, std::move(bridgeGpio));
+    sensor->setPollLimits(minPollMs, maxPollMs, pollMarginPercent);
+    SensorRegistry::get().own(std::move(sensor));
 }
 
 void createPSUSensors(
@@ -108,7 +128,9 @@ void createPSUSensors(
     sensorThresholds.emplace_back(t);
     const std::string interfacePath =
         "/xyz/openbmc_project/inventory/system/chassis/0";
-    psuSensors[sensorName] = std::make_unique<PSUSensor>(
+    // frees the name before the replacement subscribes and registers it
+    SensorRegistry::get().release(sensorName);
+    auto sensor = std::make_shared<PSUSensor>(
                 sensorPathStr, objectType, objectServer, dbusConnection, io,
                 sensorName, std::move(sensorThresholds), interfacePath,
                 sensorType,
@@ -117,13 +139,13 @@ void createPSUSensors(
                 100.0, // minReading
                 "",
                 0);
+    sensor->setPollLimits(minPollMs, maxPollMs, pollMarginPercent);
+    SensorRegistry::get().own(std::move(sensor));
 }
 
 void createFanSensors(
     boost::asio::io_service& io,
     sdbusplus::asio::object_server& objectServer,
-    boost::container::flat_map<std::string, std::unique_ptr<TachSensor>>&
-        tachSensors,
     boost::container::flat_map<std::string, std::unique_ptr<PwmSensor>>&
         pwmSensors,
     std::shared_ptr<sdbusplus::asio::connection>& dbusConnection)
@@ -152,13 +174,16 @@ void createFanSensors(
 
     std::unique_ptr<PresenceSensor> presenceSensor(nullptr);
 
-    std::optional<RedundancySensor>* redundancy = nullptr;
 
 
-    tachSensors[sensorName] = std::make_unique<TachSensor>(
+    // frees the name before the replacement subscribes and registers it
+    SensorRegistry::get().release(sensorName);
+    auto sensor = std::make_shared<TachSensor>(
                     path, baseType, objectServer, dbusConnection,
-                    std::move(presenceSensor), redundancy, io, sensorName,
+                    std::move(presenceSensor), io, sensorName,
                     std::move(sensorThresholds), interfacePath, limits);
+    sensor->setPollLimits(minPollMs, maxPollMs, pollMarginPercent);
+    SensorRegistry::get().own(std::move(sensor));
 
                 // only add new elements
                 //const std::string& sysPath = pwm.string();
@@ -171,6 +196,131 @@ void createFanSensors(
                 //                     objectServer, *path, "Fan")));
 }
 
+// creates every sensor and fan redundancy group described in flattened.json
+// and hands back its fan control zones and the daemon's settings, returns
+// false if there is no sensor so the built in sensors are created instead
+bool createConfiguredSensors(
+    boost::asio::io_service& io, sdbusplus::asio::object_server& objectServer,
+    boost::container::flat_map<std::string, std::unique_ptr<PwmSensor>>&
+        pwmSensors,
+    boost::container::flat_map<std::string, std::unique_ptr<RedundancySensor>>&
+        redundancySensors,
+    std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
+    std::vector<sensorconfig::ZoneDescriptor>& zones,
+    sensorconfig::Settings& settings)
+{
+    std::vector<sensorconfig::SensorDescriptor> descriptors;
+    std::vector<sensorconfig::RedundancyDescriptor> groups;
+    if (!sensorconfig::parseConfiguration(jsonStore, descriptors, zones,
+                                          groups, settings) ||
+        descriptors.empty())
+    {
+        return false;
+    }
+
+    // groups come first so each tach sensor can join them as it is created
+    for (const sensorconfig::RedundancyDescriptor& group : groups)
+    {
+        std::vector<std::string> children;
+        for (const sensorconfig::SensorDescriptor& config : descriptors)
+        {
+            if (config.kind == sensorconfig::SensorKind::tach &&
+                (group.children.empty() ||
+                 std::find(group.children.begin(), group.children.end(),
+                           config.name) != group.children.end()))
+            {
+                children.emplace_back("/xyz/openbmc_project/sensors/fan_tach/" +
+                                      config.name);
+            }
+        }
+        redundancySensors[group.name] = std::make_unique<RedundancySensor>(
+            group.name, group.allowedFailures, children, objectServer,
+            group.configurationPath);
+    }
+
+    SensorRegistry& registry = SensorRegistry::get();
+    for (sensorconfig::SensorDescriptor& config : descriptors)
+    {
+        // frees the name before the replacement subscribes and registers it
+        registry.release(config.name);
+        std::shared_ptr<Sensor> sensor;
+        switch (config.kind)
+        {
+            case sensorconfig::SensorKind::tach:
+            {
+                auto limits = std::make_pair<size_t, size_t>(
+                    static_cast<size_t>(config.minReading.value_or(0)),
+                    static_cast<size_t>(config.maxReading.value_or(25000)));
+                auto tach = std::make_shared<TachSensor>(
+                    config.inputPath, config.configurationType, objectServer,
+                    dbusConnection, nullptr, io, config.name,
+                    std::move(config.thresholds), config.configurationPath,
+                    limits,
+                    config.pollRateMs ? config.pollRateMs
+                                      : TachSensor::defaultPollMs);
+                for (auto& group : redundancySensors)
+                {
+                    tach->joinRedundancy(*group.second);
+                }
+                sensor = std::move(tach);
+                break;
+            }
+            case sensorconfig::SensorKind::pwm:
+            {
+                pwmSensors[config.inputPath] = std::make_unique<PwmSensor>(
+                    config.name, config.inputPath, dbusConnection,
+                    objectServer, config.configurationPath, "Fan",
+                    PwmSensor::defaultRefreshMs, pwmWriteWindowMs);
+                break;
+            }
+            case sensorconfig::SensorKind::psu:
+            {
+                sensor = std::make_shared<PSUSensor>(
+                    config.inputPath, config.configurationType, objectServer,
+                    dbusConnection, io, config.name,
+                    std::move(config.thresholds), config.configurationPath,
+                    config.sensorType,
+                    static_cast<unsigned int>(config.scaleFactor),
+                    config.maxReading.value_or(255),
+                    config.minReading.value_or(0), "", 0,
+                    config.pollRateMs ? config.pollRateMs
+                                      : PSUSensor::defaultPollMs);
+                break;
+            }
+            case sensorconfig::SensorKind::adc:
+            {
+                sensor = std::make_shared<ADCSensor>(
+                    config.inputPath, objectServer, dbusConnection, io,
+                    config.name, std::move(config.thresholds),
+                    config.scaleFactor, config.powerState,
+                    config.configurationPath, std::nullopt,
+                    config.pollRateMs ? config.pollRateMs
+                                      : ADCSensor::defaultPollMs);
+                break;
+            }
+            case sensorconfig::SensorKind::temp:
+            {
+                auto temp = std::make_shared<HwmonTempSensor>(
+                    config.inputPath, config.configurationType, objectServer,
+                    dbusConnection, io, config.name,
+                    std::move(config.thresholds), config.configurationPath,
+                    config.powerState,
+                    config.pollRateMs ? config.pollRateMs
+                                      : HwmonTempSensor::defaultPollMs);
+                temp->setupRead();
+                sensor = std::move(temp);
+                break;
+            }
+        }
+        if (sensor)
+        {
+            sensor->setPollLimits(minPollMs, maxPollMs, pollMarginPercent);
+            registry.own(std::move(sensor));
+        }
+    }
+    return true;
+}
+
 static std::shared_ptr<sdbusplus::asio::dbus_interface>
     createInterface(sdbusplus::asio::object_server& objServer,
                     const std::string& path, const std::string& interface)
@@ -300,6 +450,88 @@ void setSystemInfo(sdbusplus::asio::object_server& objServer)
     //sysIface->initialize();
 }
 
+// exposes the poll scheduler's per wakeup work, MaxBatchTasks against
+// Tasks / Batches shows how evenly sensor polling is spread over time
+void createPollStats(boost::asio::io_service& io,
+                     sdbusplus::asio::object_server& objServer)
+{
+    static std::shared_ptr<sdbusplus::asio::dbus_interface> statsIface;
+    PollScheduler& scheduler = PollScheduler::getScheduler(io);
+
+    statsIface = objServer.add_interface(
+        "/xyz/openbmc_project/ExpManager/poll",
+        "xyz.openbmc_project.ExpManager.PollStats");
+
+    auto registerStat = [&scheduler](const std::string& name,
+                                     uint64_t PollScheduler::Stats::*field) {
+        statsIface->register_property(
+            name, static_cast<uint64_t>(0),
+            [](const uint64_t&, uint64_t&) -> int {
+                throw std::runtime_error("Read only property");
+            },
+            [&scheduler, field](uint64_t& curVal) {
+                curVal = scheduler.getStats().*field;
+                return curVal;
+            });
+    };
+    registerStat("Batches", &PollScheduler::Stats::batches);
+    registerStat("Tasks", &PollScheduler::Stats::tasks);
+    registerStat("MaxBatchTasks", &PollScheduler::Stats::maxBatchTasks);
+    registerStat("BusyMicroseconds", &PollScheduler::Stats::busyUs);
+    registerStat("MaxBatchMicroseconds", &PollScheduler::Stats::maxBatchUs);
+    statsIface->initialize();
+}
+
+// name, value, unit, alarm bits and timestamp of one sensor
+using SensorReading =
+    std::tuple<std::string, double, std::string, uint8_t, uint64_t>;
+
+// one round trip for every reading instead of a GetAll per sensor object.
+// GetReadings(since) returns the current generation, every sensor that
+// changed after since and the names of the sensors removed after since. 0
+// returns all sensors and no removals.
+void createReadingsInterface(sdbusplus::asio::object_server& objServer)
+{
+    static std::shared_ptr<sdbusplus::asio::dbus_interface> readingsIface;
+
+    readingsIface =
+        objServer.add_interface("/xyz/openbmc_project/ExpManager",
+                                "xyz.openbmc_project.ExpManager.Readings");
+    readingsIface->register_method(
+        "GetReadings", [](const uint64_t since) {
+            SensorRegistry& registry = SensorRegistry::get();
+            std::vector<SensorReading> readings;
+            for (size_t id = 0; id < registry.size(); id++)
+            {
+                Sensor* sensor = registry.getSensor(id);
+                if (sensor == nullptr ||
+                    (since != 0 && registry.generations[id] <= since))
+                {
+                    continue;
+                }
+                readings.emplace_back(
+                    sensor->name, registry.values[id],
+                    sdbusplus::xyz::openbmc_project::Sensor::server::
+                        convertForMessage(sensor->unit),
+                    registry.alarms[id], registry.timestamps[id]);
+            }
+            std::vector<std::string> removed;
+            if (since != 0)
+            {
+                for (const auto& [name, generation] : registry.getTombstones())
+                {
+                    if (generation > since)
+                    {
+                        removed.emplace_back(name);
+                    }
+                }
+            }
+            return std::make_tuple(registry.getGeneration(),
+                                   std::move(readings), std::move(removed));
+        });
+    readingsIface->initialize();
+}
+
 int main()
 {
     auto bus = sdbusplus::bus::new_default();
@@ -317,19 +549,59 @@ int main()
     auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
     systemBus->request_name("xyz.openbmc_project.ExpManager");
     sdbusplus::asio::object_server objectServer(systemBus);
+    // clients fetch every sensor and inventory item with one
+    // GetManagedObjects and follow InterfacesAdded/InterfacesRemoved, which
+    // object_server emits as interfaces are initialized and removed
+    sdbusplus::server::manager::manager sensorsManager(
+        *systemBus, "/xyz/openbmc_project/sensors");
+    sdbusplus::server::manager::manager inventoryManager(
+        *systemBus, "/xyz/openbmc_project/inventory");
 
-    boost::container::flat_map<std::string, std::unique_ptr<TachSensor>>
-        tachSensors;
     boost::container::flat_map<std::string, std::unique_ptr<PwmSensor>>
         pwmSensors;
 
+    boost::container::flat_map<std::string, std::unique_ptr<RedundancySensor>>
+        redundancySensors;
+    std::unique_ptr<fancontrol::FanControl> fanControl;
+
+    // value changes are signalled at the end of their tick until the
+    // configuration sets a window
+    SensorPublisher::create(io, 0);
+    thresholds::ThresholdChecker::create(io);
+    // EntityManager's configuration is read in the background and kept
+    // current from its signals, lookups made once it is loaded never block
+    ConfigCache::get(systemBus).load();
+
     io.post([&]() {
         //setSystemInfo(objectServer); // for expaners
         //setPowerSupplyInfo(objectServer); // for power supplies
-        createFanSensors(io, objectServer, tachSensors, pwmSensors, systemBus);
-        createPSUSensors(io, objectServer, systemBus);
-        createADCSensors(io, objectServer, systemBus);
-        createTempSensors(io, objectServer, systemBus);
+        // straight from the file, without waiting for EntityManager
+        std::vector<sensorconfig::ZoneDescriptor> zones;
+        sensorconfig::Settings settings;
+        if (!createConfiguredSensors(io, objectServer, pwmSensors,
+                                     redundancySensors, systemBus, zones,
+                                     settings))
+        {
+            createFanSensors(io, objectServer, pwmSensors, systemBus);
+            createPSUSensors(io, objectServer, systemBus);
+            createADCSensors(io, objectServer, systemBus);
+            createTempSensors(io, objectServer, systemBus);
+        }
+        SensorPublisher::get()->setWindowMs(settings.publishWindowMs);
+        if (!zones.empty())
+        {
+            fanControl = std::make_unique<fancontrol::FanControl>(
+                io, std::move(zones), pwmSensors);
+        }
+        // opted in to by configuration only, a notified source hands every
+        // subscriber its value on each write, off the poll scheduler
+        for (const std::string& path : settings.notifyPaths)
+        {
+            SensorSnapshot::getSnapshot(io, path)
+                ->setUpdateMode(SensorSnapshot::UpdateMode::notify);
+        }
+        createPollStats(io, objectServer);
+        createReadingsInterface(objectServer);
     });
 
 
@@ -0,0 +1,281 @@
+#include "FanControl.hpp"
+
+#include "sensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fancontrol
+{
+namespace
+{
+// bounds value unless both limits are 0
+double limit(double value, double min, double max)
+{
+    if (min == 0 && max == 0)
+    {
+        return value;
+    }
+    return std::min(std::max(value, min), max);
+}
+} // namespace
+
+Controller::Controller(const sensorconfig::ControllerDescriptor& config) :
+    config(config)
+{
+}
+
+double Controller::step(double input, double setPoint, double dt)
+{
+    if (config.kind == sensorconfig::ControllerKind::stepwise)
+    {
+        return stepwise(input);
+    }
+    return pid(input, setPoint, dt);
+}
+
+void Controller::reset(void)
+{
+    integral = 0;
+    lastOutput = 0;
+    lastInput = std::numeric_limits<double>::quiet_NaN();
+    started = false;
+}
+
+double Controller::pid(double input, double setPoint, double dt)
+{
+    // thermal controllers act in reverse, a reading above the set point
+    // calls for more cooling
+    double error = config.fan ? setPoint - input : input - setPoint;
+
+    integral = limit(integral + config.iCoefficient * error * dt,
+                     config.iLimitMin, config.iLimitMax);
+    double output = config.pCoefficient * error + integral +
+                    config.ffGainCoefficient *
+                        (setPoint + config.ffOffCoefficient);
+    output = limit(output, config.outLimitMin, config.outLimitMax);
+
+    if (started)
+    {
+        if (config.slewNeg != 0)
+        {
+            output =
+                std::max(output, lastOutput - std::abs(config.slewNeg) * dt);
+        }
+        if (config.slewPos != 0)
+        {
+            output = std::min(output, lastOutput + config.slewPos * dt);
+        }
+    }
+    started = true;
+    lastOutput = output;
+    return output;
+}
+
+double Controller::stepwise(double input)
+{
+    if (config.readings.empty())
+    {
+        return 0;
+    }
+    // within the hysteresis of the reading the output was picked for
+    if (started && input < lastInput + config.positiveHysteresis &&
+        input > lastInput - config.negativeHysteresis)
+    {
+        return lastOutput;
+    }
+    auto above = std::upper_bound(config.readings.begin(),
+                                  config.readings.end(), input);
+    size_t index = above == config.readings.begin()
+                       ? 0
+                       : static_cast<size_t>(above - config.readings.begin()) -
+                             1;
+    started = true;
+    lastInput = input;
+    lastOutput = config.levels[index];
+    return lastOutput;
+}
+
+Zone::Zone(sensorconfig::ZoneDescriptor&& config,
+           const PwmSensors& pwmSensors) :
+    name(std::move(config.name)),
+    periodMs(config.periodMs), minThermalOutput(config.minThermalOutput),
+    failSafePercent(config.failSafePercent)
+{
+    for (const sensorconfig::ControllerDescriptor& descriptor :
+         config.controllers)
+    {
+        Controller& controller = controllers.emplace_back(descriptor);
+        for (const std::string& inputName : descriptor.inputs)
+        {
+            controller.inputs.push_back(addInput(inputName));
+        }
+        for (const std::string& outputName : descriptor.outputs)
+        {
+            auto pwm = std::find_if(
+                pwmSensors.begin(), pwmSensors.end(), [&](const auto& item) {
+                    const std::string& pwmName = item.second->getName();
+                    return pwmName == outputName ||
+                           pwmName == "Pwm_" + outputName;
+                });
+            if (pwm == pwmSensors.end())
+            {
+                std::cerr << "Zone " << name << " has no pwm " << outputName
+                          << "\n";
+                continue;
+            }
+            if (std::find(outputs.begin(), outputs.end(),
+                          pwm->second.get()) == outputs.end())
+            {
+                outputs.push_back(pwm->second.get());
+            }
+        }
+    }
+    readings.resize(inputs.size());
+}
+
+size_t Zone::addInput(const std::string& inputName)
+{
+    for (size_t ii = 0; ii < inputs.size(); ii++)
+    {
+        if (inputs[ii].name == inputName)
+        {
+            return ii;
+        }
+    }
+    inputs.emplace_back().name = inputName;
+    return inputs.size() - 1;
+}
+
+bool Zone::resolve(Input& input)
+{
+    SensorRegistry& registry = SensorRegistry::get();
+    if (input.sensor != nullptr && input.id < registry.size() &&
+        registry.getSensor(input.id) == input.sensor)
+    {
+        return true;
+    }
+    input.sensor = nullptr;
+    for (SensorRegistry::SensorId id = 0; id < registry.size(); id++)
+    {
+        Sensor* sensor = registry.getSensor(id);
+        if (sensor != nullptr && sensor->name == input.name)
+        {
+            input.id = id;
+            input.sensor = sensor;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Zone::step(void)
+{
+    const SensorRegistry& registry = SensorRegistry::get();
+    bool valid = true;
+    for (size_t ii = 0; ii < inputs.size(); ii++)
+    {
+        readings[ii] = resolve(inputs[ii])
+                           ? registry.values[inputs[ii].id]
+                           : std::numeric_limits<double>::quiet_NaN();
+        valid = valid && !std::isnan(readings[ii]);
+    }
+
+    double duty = failSafePercent;
+    if (!valid)
+    {
+        if (!failSafe)
+        {
+            std::cerr << "Zone " << name << " lost an input, failsafe at "
+                      << failSafePercent << "%\n";
+            failSafe = true;
+            for (Controller& controller : controllers)
+            {
+                controller.reset();
+            }
+        }
+    }
+    else
+    {
+        if (failSafe)
+        {
+            std::cerr << "Zone " << name << " inputs restored\n";
+            failSafe = false;
+        }
+
+        double dt = periodMs / 1000.0;
+        double demand = minThermalOutput;
+        bool fanControllers = false;
+        for (Controller& controller : controllers)
+        {
+            if (controller.isFan() || controller.inputs.empty())
+            {
+                fanControllers = fanControllers || controller.isFan();
+                continue;
+            }
+            double hottest = -std::numeric_limits<double>::infinity();
+            for (size_t input : controller.inputs)
+            {
+                hottest = std::max(hottest, readings[input]);
+            }
+            demand = std::max(demand, controller.step(
+                                          hottest, controller.getSetPoint(),
+                                          dt));
+        }
+
+        duty = demand;
+        if (fanControllers)
+        {
+            duty = 0;
+            for (Controller& controller : controllers)
+            {
+                if (!controller.isFan() || controller.inputs.empty())
+                {
+                    continue;
+                }
+                double slowest = std::numeric_limits<double>::infinity();
+                for (size_t input : controller.inputs)
+                {
+                    slowest = std::min(slowest, readings[input]);
+                }
+                duty = std::max(duty, controller.step(slowest, demand, dt));
+            }
+        }
+    }
+
+    for (PwmSensor* output : outputs)
+    {
+        output->setDuty(duty);
+    }
+}
+
+FanControl::FanControl(boost::asio::io_service& io,
+                       std::vector<sensorconfig::ZoneDescriptor>&& zoneConfigs,
+                       const PwmSensors& pwmSensors) :
+    scheduler(PollScheduler::getScheduler(io))
+{
+    for (sensorconfig::ZoneDescriptor& config : zoneConfigs)
+    {
+        auto zone = std::make_unique<Zone>(std::move(config), pwmSensors);
+        Zone* zonePtr = zone.get();
+        tasks.push_back(scheduler.add(
+            zone->getPeriodMs(),
+            PollScheduler::phaseFor(zone->getName(), zone->getPeriodMs()),
+            [zonePtr]() { zonePtr->step(); }));
+        zones.emplace_back(std::move(zone));
+    }
+}
+
+FanControl::~FanControl()
+{
+    for (PollScheduler::TaskId task : tasks)
+    {
+        scheduler.remove(task);
+    }
+}
+} // namespace fancontrol
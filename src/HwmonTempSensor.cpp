@@ -30,7 +30,6 @@
 #include <string>
 #include <vector>
 
-static constexpr unsigned int sensorPollMs = 500;
 static constexpr unsigned int sensorScaleFactor = 1000;
 static constexpr size_t warnAfterErrorCount = 10;
 
@@ -43,15 +42,16 @@ HwmonTempSensor::HwmonTempSensor(
     std::shared_ptr<sdbusplus::asio::connection>& conn,
     boost::asio::io_service& io, const std::string& sensorName,
     std::vector<thresholds::Threshold>&& _thresholds,
-    const std::string& sensorConfiguration, const PowerState powerState) :
+    const std::string& sensorConfiguration, const PowerState powerState,
+    unsigned int pollRateMs) :
     Sensor(boost::replace_all_copy(sensorName, " ", "_"),
            std::move(_thresholds), sensorConfiguration, objectType, maxReading,
            minReading,
            sdbusplus::xyz::openbmc_project::Sensor::server::Value::Unit::DegreesC
     ),
     std::enable_shared_from_this<HwmonTempSensor>(), objServer(objectServer),
-    inputDev(io, open(path.c_str(), O_RDONLY)), waitTimer(io), path(path),
-    errCount(0), readState(powerState)
+    snapshot(SensorSnapshot::getSnapshot(io, path)), path(path), errCount(0),
+    readState(powerState), pollRateMs(pollRateMs)
 {
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/temperature/" + name,
@@ -78,9 +78,7 @@ HwmonTempSensor::HwmonTempSensor(
 
 HwmonTempSensor::~HwmonTempSensor()
 {
-    // close the input dev to cancel async operations
-    inputDev.close();
-    waitTimer.cancel();
+    snapshot->unsubscribe(name, this);
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
@@ -91,47 +89,29 @@ void HwmonTempSensor::setupRead(void)
 {
     std::weak_ptr<HwmonTempSensor> weakRef = weak_from_this();
 
-    boost::asio::async_read_until(inputDev, readBuf, '\n',
-                                  [weakRef](const boost::system::error_code& ec,
-                                            std::size_t /*bytes_transfered*/) {
-                                      std::shared_ptr<HwmonTempSensor> self =
-                                          weakRef.lock();
-                                      if (self)
-                                      {
-                                          self->handleResponse(ec);
-                                      }
-                                  });
+    snapshot->subscribe(name, this, pollRateMs,
+                        [weakRef](const boost::system::error_code& ec,
+                                  const std::optional<double>& reading) {
+                            std::shared_ptr<HwmonTempSensor> self =
+                                weakRef.lock();
+                            if (self)
+                            {
+                                self->handleResponse(ec, reading);
+                            }
+                        });
 }
 
-void HwmonTempSensor::handleResponse(const boost::system::error_code& err)
+void HwmonTempSensor::handleResponse(const boost::system::error_code& err,
+                                     const std::optional<double>& reading)
 {
-    if ((err == boost::system::errc::bad_file_descriptor) ||
-        (err == boost::asio::error::misc_errors::not_found))
-    {
-        return; // we're being destroyed
-    }
-    std::istream responseStream(&readBuf);
     if (!err)
     {
-        std::string response;
-        try
+        if (reading)
         {
-            std::string line;
-            while (std::getline(responseStream, line)) {
-                std::string key{""}, value{""};
-                std::istringstream kv(line);
-                std::getline(kv, key, '=');
-                std::getline(kv, value);
-                if (this->name == key) {
-                    response = value;
-                }
-            }
-            double nvalue = std::stod(response);
-            nvalue /= sensorScaleFactor;
-            updateValue(nvalue);
+            updateValue(*reading / sensorScaleFactor);
             errCount = 0;
         }
-        catch (const std::invalid_argument&)
+        else
         {
             errCount++;
         }
@@ -157,27 +137,11 @@ void HwmonTempSensor::handleResponse(const boost::system::error_code& err)
     {
         updateValue(0);
     }
-    responseStream.clear();
-    inputDev.close();
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
+
+    if (adaptPollRate(pollRateMs))
     {
-        return; // we're no longer valid
+        snapshot->setPollRate(name, this, pollRateMs);
     }
-    inputDev.assign(fd);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(sensorPollMs));
-    std::weak_ptr<HwmonTempSensor> weakRef = weak_from_this();
-    waitTimer.async_wait([weakRef](const boost::system::error_code& ec) {
-        std::shared_ptr<HwmonTempSensor> self = weakRef.lock();
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            return; // we're being canceled
-        }
-        if (self)
-        {
-            self->setupRead();
-        }
-    });
 }
 
 void HwmonTempSensor::checkThresholds(void)
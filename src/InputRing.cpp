@@ -0,0 +1,101 @@
+#include "InputRing.hpp"
+
+#include "SensorInput.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+InputRing* InputRing::getRing(void)
+{
+    // never destroyed, inputs may still flush through it at exit
+    static InputRing* ring = [] {
+        InputRing* newRing = new InputRing();
+        if (!newRing->init())
+        {
+            delete newRing;
+            return static_cast<InputRing*>(nullptr);
+        }
+        return newRing;
+    }();
+    return ring;
+}
+
+bool InputRing::init(void)
+{
+    int ret = io_uring_queue_init(ringEntries, &ring, 0);
+    if (ret < 0)
+    {
+        std::cerr << "io_uring unavailable, reading sensors with pread: "
+                  << std::strerror(-ret) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool InputRing::queue(SensorInput& input, int fd, char* buffer, size_t size)
+{
+    if (broken)
+    {
+        return false;
+    }
+    io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    if (sqe == nullptr)
+    {
+        // ring is full, complete what is queued and start over
+        submit();
+        sqe = io_uring_get_sqe(&ring);
+        if (sqe == nullptr)
+        {
+            return false;
+        }
+    }
+    io_uring_prep_read(sqe, fd, buffer, static_cast<unsigned int>(size), 0);
+    io_uring_sqe_set_data(sqe, &input);
+    queued++;
+    return true;
+}
+
+void InputRing::submit(void)
+{
+    if (queued == 0 || broken)
+    {
+        return;
+    }
+    int ret = 0;
+    do
+    {
+        ret = io_uring_submit_and_wait(&ring, queued);
+    } while (ret == -EINTR);
+
+    if (ret < 0)
+    {
+        // inputs left waiting read with pread, the ring is not entered again
+        // so their entries never complete behind their back
+        std::cerr << "io_uring submit failed, reading sensors with pread: "
+                  << std::strerror(-ret) << "\n";
+        broken = true;
+        return;
+    }
+
+    while (queued > 0)
+    {
+        io_uring_cqe* cqe = nullptr;
+        ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret == -EINTR)
+        {
+            continue;
+        }
+        if (ret < 0)
+        {
+            std::cerr << "io_uring wait failed, reading sensors with pread: "
+                      << std::strerror(-ret) << "\n";
+            broken = true;
+            return;
+        }
+        auto* input = static_cast<SensorInput*>(io_uring_cqe_get_data(cqe));
+        input->completePrefetch(cqe->res);
+        io_uring_cqe_seen(&ring, cqe);
+        queued--;
+    }
+}
@@ -42,12 +42,12 @@ PSUSensor::PSUSensor(const std::string& path, const std::string& objectType,
                      const std::string& sensorConfiguration,
                      std::string& sensorTypeName, unsigned int factor,
                      double max, double min, const std::string& label,
-                     size_t tSize) :
+                     size_t tSize, unsigned int pollRateMs) :
     Sensor(boost::replace_all_copy(sensorName, " ", "_"),
            std::move(_thresholds), sensorConfiguration, objectType, max, min,
             sdbusplus::xyz::openbmc_project::Sensor::server::Value::Unit::Watts),
-    objServer(objectServer), inputDev(io), waitTimer(io), path(path),
-    errCount(0), sensorFactor(factor)
+    objServer(objectServer), snapshot(SensorSnapshot::getSnapshot(io, path)),
+    path(path), errCount(0), sensorFactor(factor), pollRateMs(pollRateMs)
 {
     if constexpr (DEBUG)
     {
@@ -58,14 +58,6 @@ PSUSensor::PSUSensor(const std::string& path, const std::string& objectType,
                   << sensorName << "\"\n";
     }
 
-    fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
-    {
-        std::cerr << "PSU sensor failed to open file\n";
-        return;
-    }
-    inputDev.assign(fd);
-
     std::string dbusPath = sensorPathPrefix + sensorTypeName + name;
 
     sensorInterface = objectServer.add_interface(
@@ -102,57 +94,36 @@ PSUSensor::PSUSensor(const std::string& path, const std::string& objectType,
 
 PSUSensor::~PSUSensor()
 {
-    waitTimer.cancel();
-    inputDev.close();
+    snapshot->unsubscribe(name, this);
     objServer.remove_interface(association);
     objServer.remove_interface(sensorInterface);
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
-    objServer.remove_interface(association);
 }
 
 void PSUSensor::setupRead(void)
 {
-    boost::asio::async_read_until(
-        inputDev, readBuf, '\n',
-        [&](const boost::system::error_code& ec,
-            std::size_t /*bytes_transfered*/) { handleResponse(ec); });
+    snapshot->subscribe(name, this, pollRateMs,
+                        [this](const boost::system::error_code& ec,
+                               const std::optional<double>& reading) {
+                            handleResponse(ec, reading);
+                        });
 }
 
-void PSUSensor::handleResponse(const boost::system::error_code& err)
+void PSUSensor::handleResponse(const boost::system::error_code& err,
+                               const std::optional<double>& reading)
 {
-    if (err == boost::system::errc::bad_file_descriptor)
-    {
-        std::cerr << "Bad file descriptor from\n";
-        return;
-    }
-    std::istream responseStream(&readBuf);
     if (!err)
     {
-        std::string response;
-        try
+        if (reading)
         {
-            std::string line;
-            while (std::getline(responseStream, line)) {
-                std::string key{""}, value{""};
-                std::istringstream kv(line);
-                std::getline(kv, key, '=');
-                std::getline(kv, value);
-                if (this->name == key) {
-                    response = value;
-                }
-            }
-            std::getline(responseStream, response);
-            double nvalue = std::stod(response);
-            responseStream.clear();
-            nvalue /= sensorFactor;
-
-            updateValue(nvalue);
+            updateValue(*reading / sensorFactor);
             errCount = 0;
         }
-        catch (const std::invalid_argument&)
+        else
         {
-            std::cerr << "Could not parse " << response << "\n";
+            std::cerr << "Could not parse " << name << " from " << path
+                      << "\n";
             errCount++;
         }
     }
@@ -172,16 +143,10 @@ void PSUSensor::handleResponse(const boost::system::error_code& err)
         errCount++;
     }
 
-    lseek(fd, 0, SEEK_SET);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(sensorPollMs));
-    waitTimer.async_wait([&](const boost::system::error_code& ec) {
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            std::cerr << "Failed to reschedule\n";
-            return;
-        }
-        setupRead();
-    });
+    if (adaptPollRate(pollRateMs))
+    {
+        snapshot->setPollRate(name, this, pollRateMs);
+    }
 }
 
 void PSUSensor::checkThresholds(void)
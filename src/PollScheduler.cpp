@@ -0,0 +1,382 @@
+#include "PollScheduler.hpp"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+// tasks sharing a period are spread over it by phaseFor, a build with
+// STAGGER_POLLS off fires them all on the same tick to compare against
+#ifdef POLL_STAGGER_DISABLED
+static constexpr bool staggerPolls = false;
+#else
+static constexpr bool staggerPolls = true;
+#endif
+
+// number of slots (1..64) from index to the next occupied one after it
+static unsigned int nextSlot(uint64_t mask, unsigned int index)
+{
+    unsigned int shift = (index + 1) & (TimerWheel::slotCount - 1);
+    uint64_t rotated =
+        shift ? (mask >> shift) | (mask << (TimerWheel::slotCount - shift))
+              : mask;
+    return static_cast<unsigned int>(__builtin_ctzll(rotated)) + 1;
+}
+
+void TimerWheel::insert(const Entry& entry)
+{
+    if (entry.expiry <= current)
+    {
+        place(Entry{current + 1, entry.id, entry.serial});
+        return;
+    }
+    place(entry);
+}
+
+void TimerWheel::place(const Entry& entry)
+{
+    constexpr uint64_t maxDelta = (uint64_t{1} << (slotBits * levelCount)) - 1;
+    Entry placed = entry;
+    if (placed.expiry - current > maxDelta)
+    {
+        placed.expiry = current + maxDelta;
+    }
+    uint64_t delta = placed.expiry - current;
+    unsigned int level = 0;
+    while (level + 1 < levelCount &&
+           delta >= (uint64_t{1} << (slotBits * (level + 1))))
+    {
+        level++;
+    }
+    unsigned int slot = (placed.expiry >> (slotBits * level)) & (slotCount - 1);
+    slots[level][slot].push_back(placed);
+    occupied[level] |= uint64_t{1} << slot;
+}
+
+void TimerWheel::cascade(unsigned int level)
+{
+    unsigned int slot = (current >> (slotBits * level)) & (slotCount - 1);
+    occupied[level] &= ~(uint64_t{1} << slot);
+    // everything in the slot is due within the span of the levels below, so
+    // nothing is placed back into the slot being walked
+    std::vector<Entry>& entries = slots[level][slot];
+    for (const Entry& entry : entries)
+    {
+        place(entry);
+    }
+    entries.clear();
+}
+
+void TimerWheel::advance(uint64_t tick, std::vector<Entry>& expired)
+{
+    while (current < tick)
+    {
+        // skip ticks without anything to fire or cascade
+        std::optional<uint64_t> next = nextExpiry();
+        if (!next || *next > tick)
+        {
+            current = tick;
+            return;
+        }
+        current = *next;
+
+        unsigned int level = 1;
+        while (level < levelCount &&
+               (current & ((uint64_t{1} << (slotBits * level)) - 1)) == 0)
+        {
+            level++;
+        }
+        for (unsigned int ii = level - 1; ii > 0; ii--)
+        {
+            cascade(ii);
+        }
+
+        unsigned int slot = current & (slotCount - 1);
+        std::vector<Entry>& entries = slots[0][slot];
+        expired.insert(expired.end(), entries.begin(), entries.end());
+        entries.clear();
+        occupied[0] &= ~(uint64_t{1} << slot);
+    }
+}
+
+std::optional<uint64_t> TimerWheel::nextExpiry(void) const
+{
+    std::optional<uint64_t> next;
+    for (unsigned int level = 0; level < levelCount; level++)
+    {
+        if (!occupied[level])
+        {
+            continue;
+        }
+        unsigned int shift = slotBits * level;
+        unsigned int index = (current >> shift) & (slotCount - 1);
+        uint64_t tick = ((current >> shift) + nextSlot(occupied[level], index))
+                        << shift;
+        if (!next || tick < *next)
+        {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+PollScheduler::PollScheduler(boost::asio::io_service& io) : timerFd(io)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to create poll timer: " << std::strerror(errno)
+                  << "\n";
+        return;
+    }
+    timerFd.assign(fd);
+    waitTimer();
+}
+
+PollScheduler::~PollScheduler()
+{
+    timerFd.close();
+}
+
+PollScheduler& PollScheduler::getScheduler(boost::asio::io_service& io)
+{
+    // never destroyed, a static would be torn down after io at exit and close
+    // its descriptor through a dead io_service
+    static PollScheduler* scheduler = new PollScheduler(io);
+    return *scheduler;
+}
+
+unsigned int PollScheduler::phaseFor(std::string_view name,
+                                     unsigned int periodMs)
+{
+    if (!staggerPolls || periodMs == 0)
+    {
+        return 0;
+    }
+    // FNV-1a, stable across runs and builds unlike std::hash
+    uint32_t hash = 2166136261U;
+    for (char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619U;
+    }
+    return hash % periodMs;
+}
+
+uint64_t PollScheduler::nowTicks(void) const
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t ms = (now.tv_sec - start.tv_sec) * 1000 +
+                 (now.tv_nsec - start.tv_nsec) / 1000000;
+    return static_cast<uint64_t>(std::max<int64_t>(ms, 0)) / tickMs;
+}
+
+uint64_t PollScheduler::nextDue(const Task& task, uint64_t after) const
+{
+    uint64_t next = after + 1;
+    uint64_t phase = task.phaseTicks % task.periodTicks;
+    return next + (phase + task.periodTicks - next % task.periodTicks) %
+                      task.periodTicks;
+}
+
+PollScheduler::TaskId PollScheduler::add(unsigned int periodMs,
+                                         unsigned int phaseMs,
+                                         std::function<void(void)>&& callback,
+                                         std::function<void(void)>&& prepare)
+{
+    TaskId id;
+    if (!freeTasks.empty())
+    {
+        id = freeTasks.back();
+        freeTasks.pop_back();
+    }
+    else
+    {
+        id = tasks.size();
+        tasks.emplace_back(Task{0, 0, 0, false, nullptr, nullptr});
+    }
+    Task& task = tasks[id];
+    task.periodTicks = std::max(1U, (periodMs + tickMs / 2) / tickMs);
+    task.phaseTicks = phaseMs / tickMs;
+    task.serial++;
+    task.active = true;
+    task.callback = std::move(callback);
+    task.prepare = std::move(prepare);
+
+    wheel.insert({nextDue(task, std::max(wheel.now(), nowTicks())), id,
+                  task.serial});
+    if (!dispatching)
+    {
+        arm();
+    }
+    return id;
+}
+
+void PollScheduler::remove(TaskId id)
+{
+    if (id >= tasks.size() || !tasks[id].active)
+    {
+        return;
+    }
+    Task& task = tasks[id];
+    task.active = false;
+    // entries left on the wheel no longer match and are dropped on expiry
+    task.serial++;
+    if (dispatching)
+    {
+        // the callback may be the one running, free it after the batch
+        removedTasks.push_back(id);
+        return;
+    }
+    task.callback = nullptr;
+    task.prepare = nullptr;
+    freeTasks.push_back(id);
+}
+
+void PollScheduler::setPeriod(TaskId id, unsigned int periodMs,
+                              unsigned int phaseMs)
+{
+    if (id >= tasks.size() || !tasks[id].active)
+    {
+        return;
+    }
+    Task& task = tasks[id];
+    task.periodTicks = std::max(1U, (periodMs + tickMs / 2) / tickMs);
+    task.phaseTicks = phaseMs / tickMs;
+    // the pending entry is dropped on expiry, next one is on the new grid
+    task.serial++;
+    wheel.insert({nextDue(task, std::max(wheel.now(), nowTicks())), id,
+                  task.serial});
+    if (!dispatching)
+    {
+        arm();
+    }
+}
+
+void PollScheduler::arm(void)
+{
+    std::optional<uint64_t> next = wheel.nextExpiry();
+    if (next == armedTick)
+    {
+        return;
+    }
+    armedTick = next;
+
+    itimerspec spec = {};
+    if (next)
+    {
+        uint64_t ms = *next * tickMs;
+        spec.it_value.tv_sec = start.tv_sec + static_cast<time_t>(ms / 1000);
+        spec.it_value.tv_nsec =
+            start.tv_nsec + static_cast<long>(ms % 1000) * 1000000;
+        if (spec.it_value.tv_nsec >= 1000000000)
+        {
+            spec.it_value.tv_sec++;
+            spec.it_value.tv_nsec -= 1000000000;
+        }
+    }
+    // an all zero value disarms the timer when nothing is scheduled
+    if (timerfd_settime(timerFd.native_handle(), TFD_TIMER_ABSTIME, &spec,
+                        nullptr) < 0)
+    {
+        std::cerr << "Failed to arm poll timer: " << std::strerror(errno)
+                  << "\n";
+    }
+}
+
+void PollScheduler::waitTimer(void)
+{
+    timerFd.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                       [this](const boost::system::error_code& ec) {
+                           if (ec == boost::asio::error::operation_aborted)
+                           {
+                               return; // we're being canceled
+                           }
+                           else if (ec)
+                           {
+                               std::cerr << "Poll timer error " << ec.message()
+                                         << "\n";
+                           }
+                           else
+                           {
+                               handleTimer();
+                           }
+                           waitTimer();
+                       });
+}
+
+void PollScheduler::handleTimer(void)
+{
+    uint64_t expirations = 0;
+    if (read(timerFd.native_handle(), &expirations, sizeof(expirations)) < 0 &&
+        errno != EAGAIN)
+    {
+        std::cerr << "Failed to read poll timer: " << std::strerror(errno)
+                  << "\n";
+    }
+    armedTick.reset();
+
+    expired.clear();
+    wheel.advance(nowTicks(), expired);
+    batch++;
+
+    // reschedule first so a callback removing its own task wins
+    for (const TimerWheel::Entry& entry : expired)
+    {
+        Task& task = tasks[entry.id];
+        if (task.active && task.serial == entry.serial)
+        {
+            wheel.insert({nextDue(task, wheel.now()), entry.id, task.serial});
+        }
+    }
+
+    auto batchStart = std::chrono::steady_clock::now();
+    uint64_t batchTasks = 0;
+    dispatching = true;
+    for (const TimerWheel::Entry& entry : expired)
+    {
+        Task& task = tasks[entry.id];
+        if (task.prepare && task.active && task.serial == entry.serial)
+        {
+            task.prepare();
+        }
+    }
+    for (const TimerWheel::Entry& entry : expired)
+    {
+        Task& task = tasks[entry.id];
+        if (task.active && task.serial == entry.serial)
+        {
+            task.callback();
+            batchTasks++;
+        }
+    }
+    dispatching = false;
+
+    uint64_t batchUs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - batchStart)
+            .count());
+    stats.batches++;
+    stats.tasks += batchTasks;
+    stats.maxBatchTasks = std::max(stats.maxBatchTasks, batchTasks);
+    stats.busyUs += batchUs;
+    stats.maxBatchUs = std::max(stats.maxBatchUs, batchUs);
+
+    for (TaskId id : removedTasks)
+    {
+        tasks[id].callback = nullptr;
+        tasks[id].prepare = nullptr;
+        freeTasks.push_back(id);
+    }
+    removedTasks.clear();
+    arm();
+}
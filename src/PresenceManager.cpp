@@ -0,0 +1,300 @@
+#include "PresenceManager.hpp"
+
+#include "TachSensor.hpp"
+
+#include <sys/epoll.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// ready lines taken from the epoll set per epoll_wait
+static constexpr size_t maxEvents = 32;
+
+PresenceManager::PresenceManager(boost::asio::io_service& io) :
+    io(io), epollFd(io)
+{
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to create presence epoll set: "
+                  << std::strerror(errno) << "\n";
+        return;
+    }
+    epollFd.assign(fd);
+}
+
+PresenceManager& PresenceManager::get(boost::asio::io_service& io)
+{
+    // never destroyed, the sensors remove themselves from it
+    static PresenceManager* manager = new PresenceManager(io);
+    return *manager;
+}
+
+bool PresenceManager::add(PresenceSensor* sensor, const std::string& pinName,
+                          bool inverted)
+{
+    gpiod::line line = gpiod::find_line(pinName);
+    if (!line)
+    {
+        std::cerr << "Error requesting gpio: " << pinName << "\n";
+        return false;
+    }
+
+    std::string chipName = line.get_chip().name();
+    size_t group = 0;
+    for (; group < groups.size(); group++)
+    {
+        if (!groups[group].requested &&
+            (groups[group].pins.empty() ||
+             (groups[group].chipName == chipName &&
+              groups[group].inverted == inverted &&
+              groups[group].pins.size() < gpiod::line_bulk::MAX_LINES)))
+        {
+            break;
+        }
+    }
+    if (group == groups.size())
+    {
+        groups.emplace_back();
+    }
+    if (groups[group].pins.empty())
+    {
+        groups[group].chipName = chipName;
+        groups[group].inverted = inverted;
+    }
+
+    size_t index = 0;
+    while (index < pins.size() && pins[index].sensor != nullptr)
+    {
+        index++;
+    }
+    if (index == pins.size())
+    {
+        pins.emplace_back();
+    }
+    pins[index] = {line, sensor, group};
+    groups[group].lines.append(line);
+    groups[group].pins.push_back(index);
+
+    // the sensors created in this handler all join the same request
+    if (!requestPending)
+    {
+        requestPending = true;
+        io.post([this]() { request(); });
+    }
+    return true;
+}
+
+void PresenceManager::remove(PresenceSensor* sensor)
+{
+    for (size_t index = 0; index < pins.size(); index++)
+    {
+        Pin& pin = pins[index];
+        if (pin.sensor != sensor)
+        {
+            continue;
+        }
+        Group& group = groups[pin.group];
+        if (pin.line.is_requested())
+        {
+            if (epollFd.is_open())
+            {
+                epoll_ctl(epollFd.native_handle(), EPOLL_CTL_DEL,
+                          pin.line.event_get_fd(), nullptr);
+            }
+            pin.line.release();
+        }
+        auto member = std::find(group.pins.begin(), group.pins.end(), index);
+        if (member != group.pins.end())
+        {
+            group.pins.erase(member);
+            rebuild(group);
+        }
+        if (group.pins.empty())
+        {
+            group.requested = false;
+        }
+        pin = Pin();
+    }
+}
+
+void PresenceManager::rebuild(Group& group)
+{
+    group.lines.clear();
+    for (size_t index : group.pins)
+    {
+        group.lines.append(pins[index].line);
+    }
+}
+
+void PresenceManager::request(void)
+{
+    requestPending = false;
+    for (Group& group : groups)
+    {
+        if (group.requested)
+        {
+            continue;
+        }
+        if (group.pins.empty())
+        {
+            continue;
+        }
+        group.requested = true;
+        gpiod::line_request config = {
+            "FanSensor", gpiod::line_request::EVENT_BOTH_EDGES,
+            group.inverted ? gpiod::line_request::FLAG_ACTIVE_LOW : 0};
+        try
+        {
+            group.lines.request(config);
+        }
+        catch (const std::system_error& e)
+        {
+            std::cerr << "Error requesting presence gpios of "
+                      << group.chipName << ": " << e.what() << "\n";
+            requestEach(group, config);
+            if (group.pins.empty())
+            {
+                group.requested = false;
+                continue;
+            }
+        }
+
+        for (size_t index : group.pins)
+        {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u64 = index;
+            if (!epollFd.is_open() ||
+                epoll_ctl(epollFd.native_handle(), EPOLL_CTL_ADD,
+                          pins[index].line.event_get_fd(), &event) < 0)
+            {
+                std::cerr << "Failed to watch presence gpio "
+                          << pins[index].line.name() << "\n";
+            }
+        }
+        apply(group, false);
+    }
+    if (!watching && epollFd.is_open())
+    {
+        watching = true;
+        watch();
+    }
+}
+
+void PresenceManager::requestEach(Group& group,
+                                  const gpiod::line_request& config)
+{
+    std::vector<size_t> requested;
+    for (size_t index : group.pins)
+    {
+        try
+        {
+            pins[index].line.request(config);
+            requested.push_back(index);
+        }
+        catch (const std::system_error& e)
+        {
+            std::cerr << "Error requesting presence gpio "
+                      << pins[index].line.name() << ": " << e.what() << "\n";
+            pins[index].sensor->update(false, false);
+        }
+    }
+    group.pins = std::move(requested);
+    rebuild(group);
+}
+
+void PresenceManager::watch(void)
+{
+    epollFd.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                       [this](const boost::system::error_code& ec) {
+                           if (ec == boost::system::errc::bad_file_descriptor)
+                           {
+                               return; // we're being destroyed
+                           }
+                           else if (ec)
+                           {
+                               std::cerr << "Error on presence gpios\n";
+                           }
+                           else
+                           {
+                               drain();
+                           }
+                           watch();
+                       });
+}
+
+void PresenceManager::drain(void)
+{
+    std::array<epoll_event, maxEvents> events;
+    int count = 0;
+    do
+    {
+        count = epoll_wait(epollFd.native_handle(), events.data(),
+                           static_cast<int>(events.size()), 0);
+        for (int ii = 0; ii < count; ii++)
+        {
+            Pin& pin = pins[events[ii].data.u64];
+            if (pin.sensor == nullptr)
+            {
+                continue;
+            }
+            try
+            {
+                // only the level read afterwards matters, not each edge
+                pin.line.event_read_multiple();
+            }
+            catch (const std::system_error& e)
+            {
+                // its events would stay pending and be returned forever, the
+                // level is still read with the rest of its group
+                std::cerr << "Error reading presence gpio " << pin.line.name()
+                          << ", no longer watching its edges: " << e.what()
+                          << "\n";
+                epoll_ctl(epollFd.native_handle(), EPOLL_CTL_DEL,
+                          pin.line.event_get_fd(), nullptr);
+            }
+            groups[pin.group].changed = true;
+        }
+        // level triggered, lines with edges left over are returned again
+    } while (count > 0);
+
+    for (Group& group : groups)
+    {
+        if (group.changed)
+        {
+            apply(group, true);
+        }
+    }
+}
+
+void PresenceManager::apply(Group& group, bool edge)
+{
+    group.changed = false;
+    std::vector<int> values;
+    try
+    {
+        values = group.lines.get_values();
+    }
+    catch (const std::system_error& e)
+    {
+        std::cerr << "Error reading presence gpios of " << group.chipName
+                  << ": " << e.what() << "\n";
+        return;
+    }
+    for (size_t ii = 0; ii < values.size() && ii < group.pins.size(); ii++)
+    {
+        PresenceSensor* sensor = pins[group.pins[ii]].sensor;
+        if (sensor != nullptr)
+        {
+            sensor->update(values[ii] != 0, edge);
+        }
+    }
+}
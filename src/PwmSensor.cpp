@@ -15,13 +15,23 @@
 */
 #include "PwmSensor.hpp"
 
+#include "ReadingParser.hpp"
 #include "Utils.hpp"
 
-#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
 #include <iostream>
 #include <sdbusplus/asio/object_server.hpp>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 static constexpr size_t pwmMax = 255;
 static constexpr double defaultPwm = 30.0;
@@ -30,21 +40,43 @@ PwmSensor::PwmSensor(const std::string& name, const std::string& sysPath,
                      std::shared_ptr<sdbusplus::asio::connection>& conn,
                      sdbusplus::asio::object_server& objectServer,
                      const std::string& sensorConfiguration,
-                     const std::string& sensorType) :
+                     const std::string& sensorType, unsigned int refreshMs,
+                     unsigned int writeWindowMs) :
     sysPath(sysPath),
-    objectServer(objectServer), name(name)
+    objectServer(objectServer), name(name),
+    scheduler(PollScheduler::getScheduler(conn->get_io_context())),
+    writeTimer(conn->get_io_context()), writeWindowMs(writeWindowMs)
 {
+    fd = open(sysPath.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open pwm " << sysPath << ": "
+                  << std::strerror(errno) << "\n";
+    }
+    else
+    {
+        struct stat fileInfo = {};
+        regularFile = fstat(fd, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode);
+    }
+
     // add interface under sensor and Control.FanPwm as Control is used
     // in obmc project, also add sensor so it can be viewed as a sensor
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/fan_pwm/" + name,
         "xyz.openbmc_project.Sensor.Value");
-    uint32_t pwmValue = getValue(false);
-    if (!pwmValue)
+    uint32_t initialValue = 0;
+    if (readValue(initialValue))
+    {
+        pwmValue = initialValue;
+    }
+    else
+    {
+        std::cerr << "Error reading pwm at " << sysPath << "\n";
+    }
+    if (!pwmValue && fd >= 0)
     {
         // default pwm to non 0
-        pwmValue = static_cast<uint32_t>(pwmMax * (defaultPwm / 100));
-        setValue(pwmValue);
+        setValue(static_cast<uint32_t>(pwmMax * (defaultPwm / 100)));
     }
     double fValue = 100.0 * (static_cast<double>(pwmValue) / pwmMax);
     sensorInterface->register_property(
@@ -60,22 +92,13 @@ PwmSensor::PwmSensor(const std::string& name, const std::string& sysPath,
                 return 1;
             }
             double value = (req / 100) * pwmMax;
-            setValue(static_cast<int>(value));
+            requestValue(static_cast<uint32_t>(value), false);
             resp = req;
-
-            controlInterface->signal_property("Target");
-
             return 1;
         },
         [this](double& curVal) {
-            double value = 100.0 * (static_cast<double>(getValue()) / pwmMax);
-            if (curVal != value)
-            {
-                curVal = value;
-                controlInterface->signal_property("Target");
-                sensorInterface->signal_property("Value");
-            }
-
+            // refresh() signals changes read back from the attribute
+            curVal = 100.0 * (static_cast<double>(pwmValue) / pwmMax);
             return curVal;
         });
     // pwm sensor interface is in percent
@@ -97,27 +120,31 @@ PwmSensor::PwmSensor(const std::string& name, const std::string& sysPath,
             {
                 return 1;
             }
-            setValue(req);
+            requestValue(static_cast<uint32_t>(req), true);
             resp = req;
-
-            sensorInterface->signal_property("Value");
-
             return 1;
         },
         [this](uint64_t& curVal) {
-            uint64_t value = getValue();
-            if (curVal != value)
-            {
-                curVal = value;
-                controlInterface->signal_property("Target");
-                sensorInterface->signal_property("Value");
-            }
-
+            curVal = pwmValue;
             return curVal;
         });
     sensorInterface->initialize();
     controlInterface->initialize();
 
+    statsInterface = objectServer.add_interface(
+        "/xyz/openbmc_project/control/fanpwm/" + name,
+        "xyz.openbmc_project.ExpManager.PwmStats");
+    statsInterface->register_property(
+        "MergedWrites", static_cast<uint64_t>(0),
+        [](const uint64_t&, uint64_t&) -> int {
+            throw std::runtime_error("Read only property");
+        },
+        [this](uint64_t& curVal) {
+            curVal = mergedWrites;
+            return curVal;
+        });
+    statsInterface->initialize();
+
     association = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/fan_pwm/" + name, association::interface);
 
@@ -131,51 +158,154 @@ PwmSensor::PwmSensor(const std::string& name, const std::string& sysPath,
     {
         createAssociation(association, sensorConfiguration);
     }
+
+    refreshTask = scheduler.add(refreshMs,
+                                PollScheduler::phaseFor(name, refreshMs),
+                                [this]() { refresh(); });
 }
 PwmSensor::~PwmSensor()
 {
+    scheduler.remove(refreshTask);
+    writeTimer.cancel();
+    if (fd >= 0)
+    {
+        close(fd);
+    }
     objectServer.remove_interface(sensorInterface);
     objectServer.remove_interface(controlInterface);
     objectServer.remove_interface(association);
+    objectServer.remove_interface(statsInterface);
 }
 
-void PwmSensor::setValue(uint32_t value)
+void PwmSensor::requestValue(uint32_t value, bool byTarget)
 {
-    std::ofstream ref(sysPath);
-    if (!ref.good())
+    setByTarget = byTarget;
+    if (writeWindowMs == 0)
     {
-        throw std::runtime_error("Bad Write File");
+        setValue(value);
+        signalOther();
+        return;
+    }
+    pwmValue = value;
+    if (writePending)
+    {
+        mergedWrites++;
+        return;
+    }
+    writePending = true;
+    writeTimer.expires_from_now(boost::posix_time::milliseconds(writeWindowMs));
+    writeTimer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return; // replaced by setDuty or we're being destroyed
+        }
+        applyValue();
+    });
+}
+
+void PwmSensor::applyValue(void)
+{
+    writePending = false;
+    try
+    {
+        setValue(pwmValue);
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << "Error writing pwm " << sysPath << ": " << e.what()
+                  << "\n";
+        return;
+    }
+    signalOther();
+}
+
+void PwmSensor::signalOther(void)
+{
+    if (setByTarget)
+    {
+        sensorInterface->signal_property("Value");
+    }
+    else
+    {
+        controlInterface->signal_property("Target");
     }
-    ref << value;
 }
 
-// on success returns pwm, on failure throws except on initialization, where it
-// prints an error and returns 0
-uint32_t PwmSensor::getValue(bool errThrow)
+void PwmSensor::setDuty(double percent)
 {
-    std::ifstream ref(sysPath);
-    if (!ref.good())
+    auto value = static_cast<uint32_t>(std::clamp(percent, 0.0, 100.0) / 100 *
+                                       pwmMax);
+    if (value == pwmValue && !writePending)
     {
-        return -1;
+        return;
     }
-    std::string line;
-    if (!std::getline(ref, line))
+    if (writePending)
     {
-        return -1;
+        writePending = false;
+        writeTimer.cancel();
     }
     try
     {
-        uint32_t value = std::stoi(line);
-        return value;
+        setValue(value);
     }
-    catch (std::invalid_argument&)
+    catch (const std::runtime_error& e)
     {
-        std::cerr << "Error reading pwm at " << sysPath << "\n";
-        // throw if not initial read to be caught by dbus bindings
-        if (errThrow)
-        {
-            throw std::runtime_error("Bad Read");
-        }
+        std::cerr << "Error writing pwm " << sysPath << ": " << e.what()
+                  << "\n";
+        return;
+    }
+    controlInterface->signal_property("Target");
+    sensorInterface->signal_property("Value");
+}
+
+void PwmSensor::setValue(uint32_t value)
+{
+    std::array<char, 16> buf;
+    char* end = std::to_chars(buf.data(), buf.data() + buf.size() - 1, value)
+                    .ptr;
+    *end++ = '\n';
+    size_t size = static_cast<size_t>(end - buf.data());
+    if (fd < 0 ||
+        pwrite(fd, buf.data(), size, 0) != static_cast<ssize_t>(size))
+    {
+        throw std::runtime_error("Bad Write File");
+    }
+    if (regularFile && ftruncate(fd, static_cast<off_t>(size)) < 0)
+    {
+        std::cerr << "Failed to truncate " << sysPath << ": "
+                  << std::strerror(errno) << "\n";
+    }
+    pwmValue = value;
+}
+
+bool PwmSensor::readValue(uint32_t& value)
+{
+    if (fd < 0)
+    {
+        return false;
+    }
+    std::array<char, 32> buf;
+    ssize_t size = pread(fd, buf.data(), buf.size(), 0);
+    if (size <= 0)
+    {
+        return false;
+    }
+    std::string_view text =
+        reading::trim(std::string_view(buf.data(), static_cast<size_t>(size)));
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(),
+                                     value);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+void PwmSensor::refresh(void)
+{
+    uint32_t value = 0;
+    // a pending write would be undone by what it is about to replace
+    if (writePending || !readValue(value) || value == pwmValue)
+    {
+        return;
     }
-    return 0;
+    pwmValue = value;
+    controlInterface->signal_property("Target");
+    sensorInterface->signal_property("Value");
 }
@@ -0,0 +1,62 @@
+#include "ReadingParser.hpp"
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+namespace reading
+{
+std::string_view trim(std::string_view text)
+{
+    constexpr std::string_view blanks = " \t\r";
+    size_t begin = text.find_first_not_of(blanks);
+    if (begin == std::string_view::npos)
+    {
+        return std::string_view();
+    }
+    size_t end = text.find_last_not_of(blanks);
+    return text.substr(begin, end - begin + 1);
+}
+
+bool splitLine(std::string_view line, std::string_view& key,
+               std::string_view& value)
+{
+    size_t separator = line.find('=');
+    if (separator == std::string_view::npos)
+    {
+        return false;
+    }
+    key = line.substr(0, separator);
+    value = line.substr(separator + 1);
+    return true;
+}
+
+ParseStatus parseValue(std::string_view text, double& value)
+{
+    text = trim(text);
+    if (text.empty())
+    {
+        return ParseStatus::empty;
+    }
+    // from_chars does not take the sign stod accepts
+    if (text.front() == '+')
+    {
+        text.remove_prefix(1);
+        if (text.empty() || text.front() == '-')
+        {
+            return ParseStatus::invalid;
+        }
+    }
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, value);
+    if (ec == std::errc::result_out_of_range)
+    {
+        return ParseStatus::outOfRange;
+    }
+    if (ec != std::errc() || ptr != end)
+    {
+        return ParseStatus::invalid;
+    }
+    return ParseStatus::ok;
+}
+} // namespace reading
@@ -0,0 +1,628 @@
+#include "SensorConfig.hpp"
+
+#include "VariantVisitors.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace sensorconfig
+{
+namespace
+{
+constexpr std::string_view configurationPrefix =
+    "xyz.openbmc_project.Configuration.";
+
+// a Value held longer than this is no longer current for any client
+constexpr double maxPublishWindowMs = 10000;
+
+constexpr std::array<std::pair<std::string_view, SensorKind>, 20> knownTypes =
+    {{{"AspeedFan", SensorKind::tach},   {"I2CFan", SensorKind::tach},
+      {"NuvotonFan", SensorKind::tach},  {"ADC", SensorKind::adc},
+      {"pmbus", SensorKind::psu},        {"ADM1272", SensorKind::psu},
+      {"ADM1275", SensorKind::psu},      {"ADM1278", SensorKind::psu},
+      {"INA230", SensorKind::psu},       {"ISL68137", SensorKind::psu},
+      {"MAX20730", SensorKind::psu},     {"TMP75", SensorKind::temp},
+      {"TMP112", SensorKind::temp},      {"TMP175", SensorKind::temp},
+      {"TMP421", SensorKind::temp},      {"TMP441", SensorKind::temp},
+      {"EMC1413", SensorKind::temp},     {"LM75A", SensorKind::temp},
+      {"MAX31725", SensorKind::temp},    {"MAX31730", SensorKind::temp}}};
+
+std::optional<SensorKind> kindOf(std::string_view interface)
+{
+    if (interface.substr(0, configurationPrefix.size()) !=
+        configurationPrefix)
+    {
+        return std::nullopt;
+    }
+    std::string_view type = interface.substr(configurationPrefix.size());
+    for (const auto& [name, kind] : knownTypes)
+    {
+        if (type == name)
+        {
+            return kind;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string> getString(const SensorBaseConfigMap& config,
+                                     const char* property)
+{
+    auto find = config.find(property);
+    if (find == config.end())
+    {
+        return std::nullopt;
+    }
+    return std::visit(VariantToStringVisitor(), find->second);
+}
+
+std::optional<double> getDouble(const SensorBaseConfigMap& config,
+                                const char* property)
+{
+    auto find = config.find(property);
+    if (find == config.end())
+    {
+        return std::nullopt;
+    }
+    return std::visit(VariantToDoubleVisitor(), find->second);
+}
+
+template <typename T>
+std::vector<T> getArray(const SensorBaseConfigMap& config,
+                        const char* property)
+{
+    auto find = config.find(property);
+    if (find == config.end())
+    {
+        return {};
+    }
+    if (const auto* values = std::get_if<std::vector<T>>(&find->second))
+    {
+        return *values;
+    }
+    // an empty array is read as one of strings
+    const auto* empty = std::get_if<std::vector<std::string>>(&find->second);
+    if (empty == nullptr || !empty->empty())
+    {
+        throw std::invalid_argument(std::string(property) +
+                                    " is not an array of the expected type");
+    }
+    return {};
+}
+
+// sensor names as they appear on D-Bus
+std::vector<std::string> getNames(const SensorBaseConfigMap& config,
+                                  const char* property)
+{
+    std::vector<std::string> names = getArray<std::string>(config, property);
+    for (std::string& name : names)
+    {
+        name = std::regex_replace(name, illegalDbusRegex, "_");
+    }
+    return names;
+}
+
+// readings are divided by the factor, PSU sensors take a whole number
+bool validScaleFactor(SensorKind kind, double scale)
+{
+    if (!std::isfinite(scale) || scale <= 0)
+    {
+        return false;
+    }
+    return kind != SensorKind::psu ||
+           (scale >= 1 && std::trunc(scale) == scale &&
+            scale <= std::numeric_limits<unsigned int>::max());
+}
+
+SensorDescriptor makeSensor(SensorKind kind, const std::string& name,
+                            const std::string& path,
+                            const std::string& interface,
+                            const SensorBaseConfigMap& config,
+                            const SensorData& object)
+{
+    SensorDescriptor sensor;
+    sensor.kind = kind;
+    sensor.name = std::regex_replace(name, illegalDbusRegex, "_");
+    sensor.configurationPath = path;
+    sensor.configurationType = interface;
+    sensor.inputPath = getString(config, "Path").value_or(defaultInputPath);
+    if (!parseThresholdsFromConfig(object, sensor.thresholds))
+    {
+        std::cerr << "Error parsing thresholds of " << path << "\n";
+    }
+    if (std::optional<std::string> powerState =
+            getString(config, "PowerState"))
+    {
+        setReadState(*powerState, sensor.powerState);
+    }
+    sensor.minReading = getDouble(config, "MinReading");
+    sensor.maxReading = getDouble(config, "MaxReading");
+    if (std::optional<double> scale = getDouble(config, "ScaleFactor"))
+    {
+        if (validScaleFactor(kind, *scale))
+        {
+            sensor.scaleFactor = *scale;
+        }
+        else
+        {
+            std::cerr << "Ignoring ScaleFactor " << *scale << " of " << path
+                      << "\n";
+        }
+    }
+    sensor.pollRateMs = getPollRate(config, 0);
+    sensor.sensorType = getString(config, "SensorType").value_or("power");
+    if (sensor.sensorType.empty() || sensor.sensorType.back() != '/')
+    {
+        sensor.sensorType += '/';
+    }
+    return sensor;
+}
+
+// turns the interfaces of one configuration object into descriptors
+void addSensors(const std::string& path, const SensorData& object,
+                std::vector<SensorDescriptor>& sensors)
+{
+    for (const auto& [interface, config] : object)
+    {
+        std::optional<SensorKind> kind = kindOf(interface);
+        if (!kind)
+        {
+            continue;
+        }
+        try
+        {
+            std::optional<std::string> name = getString(config, "Name");
+            if (!name)
+            {
+                std::cerr << "Configuration " << path << " has no Name\n";
+                continue;
+            }
+            SensorDescriptor sensor =
+                makeSensor(*kind, *name, path, interface, config, object);
+
+            // a fan driven by a pwm attribute gets a pwm sensor next to it
+            std::optional<std::string> pwmPath = getString(config, "PwmPath");
+            if (sensor.kind == SensorKind::tach && pwmPath)
+            {
+                SensorDescriptor pwm;
+                pwm.kind = SensorKind::pwm;
+                pwm.name = "Pwm_" + sensor.name;
+                pwm.configurationPath = path;
+                pwm.configurationType = interface;
+                pwm.inputPath = *pwmPath;
+                sensors.emplace_back(std::move(sensor));
+                sensors.emplace_back(std::move(pwm));
+                continue;
+            }
+            sensors.emplace_back(std::move(sensor));
+        }
+        catch (const std::invalid_argument& e)
+        {
+            // a property of an unexpected type
+            std::cerr << "Error reading configuration " << path << ": "
+                      << e.what() << "\n";
+        }
+    }
+}
+
+ControllerDescriptor makeController(ControllerKind kind,
+                                    const std::string& name,
+                                    const SensorBaseConfigMap& config)
+{
+    ControllerDescriptor controller;
+    controller.kind = kind;
+    controller.name = name;
+    controller.fan = getString(config, "Class").value_or("") == "fan";
+    controller.inputs = getNames(config, "Inputs");
+    controller.outputs = getNames(config, "Outputs");
+    controller.zones = getArray<std::string>(config, "Zones");
+    if (kind == ControllerKind::stepwise)
+    {
+        controller.readings = getArray<double>(config, "Reading");
+        controller.levels = getArray<double>(config, "Output");
+        if (controller.readings.size() != controller.levels.size())
+        {
+            throw std::invalid_argument("Reading and Output differ in size");
+        }
+        controller.positiveHysteresis =
+            getDouble(config, "PositiveHysteresis").value_or(0);
+        controller.negativeHysteresis =
+            getDouble(config, "NegativeHysteresis").value_or(0);
+        return controller;
+    }
+    controller.setPoint = getDouble(config, "SetPoint").value_or(0);
+    controller.pCoefficient = getDouble(config, "PCoefficient").value_or(0);
+    controller.iCoefficient = getDouble(config, "ICoefficient").value_or(0);
+    controller.ffGainCoefficient =
+        getDouble(config, "FFGainCoefficient").value_or(0);
+    controller.ffOffCoefficient =
+        getDouble(config, "FFOffCoefficient").value_or(0);
+    controller.iLimitMin = getDouble(config, "ILimitMin").value_or(0);
+    controller.iLimitMax = getDouble(config, "ILimitMax").value_or(0);
+    controller.outLimitMin = getDouble(config, "OutLimitMin").value_or(0);
+    controller.outLimitMax = getDouble(config, "OutLimitMax").value_or(0);
+    controller.slewNeg = getDouble(config, "SlewNeg").value_or(0);
+    controller.slewPos = getDouble(config, "SlewPos").value_or(0);
+    return controller;
+}
+
+// picks the fan control configurations out of one configuration object, the
+// controllers are attached to their zones once the whole file was read
+void addControls(const std::string& path, const SensorData& object,
+                 std::vector<ZoneDescriptor>& zones,
+                 std::vector<ControllerDescriptor>& controllers)
+{
+    for (const auto& [interface, config] : object)
+    {
+        if (interface.compare(0, configurationPrefix.size(),
+                              configurationPrefix) != 0)
+        {
+            continue;
+        }
+        std::string_view type =
+            std::string_view(interface).substr(configurationPrefix.size());
+        if (type != "Pid" && type != "Stepwise" && type != "Pid.Zone")
+        {
+            continue;
+        }
+        try
+        {
+            std::optional<std::string> name = getString(config, "Name");
+            if (!name)
+            {
+                std::cerr << "Configuration " << path << " has no Name\n";
+                continue;
+            }
+            if (type == "Pid.Zone")
+            {
+                ZoneDescriptor zone;
+                zone.name = *name;
+                zone.minThermalOutput =
+                    getDouble(config, "MinThermalOutput").value_or(0);
+                zone.failSafePercent =
+                    getDouble(config, "FailSafePercent").value_or(100);
+                std::optional<double> period =
+                    getDouble(config, "CycleIntervalTimeMS");
+                if (period && *period > 0)
+                {
+                    zone.periodMs = static_cast<unsigned int>(*period);
+                }
+                zones.emplace_back(std::move(zone));
+                continue;
+            }
+            controllers.emplace_back(makeController(
+                type == "Pid" ? ControllerKind::pid : ControllerKind::stepwise,
+                *name, config));
+        }
+        catch (const std::invalid_argument& e)
+        {
+            std::cerr << "Error reading configuration " << path << ": "
+                      << e.what() << "\n";
+        }
+    }
+}
+
+void addRedundancy(const std::string& path, const SensorData& object,
+                   std::vector<RedundancyDescriptor>& groups)
+{
+    auto config = object.find(std::string(configurationPrefix) +
+                              "FanRedundancy");
+    if (config == object.end())
+    {
+        return;
+    }
+    try
+    {
+        std::optional<std::string> name = getString(config->second, "Name");
+        if (!name)
+        {
+            std::cerr << "Configuration " << path << " has no Name\n";
+            return;
+        }
+        RedundancyDescriptor group;
+        group.name = std::regex_replace(*name, illegalDbusRegex, "_");
+        group.configurationPath = path;
+        group.allowedFailures = static_cast<size_t>(
+            getDouble(config->second, "AllowedFailures").value_or(0));
+        group.children = getNames(config->second, "Collection");
+        groups.emplace_back(std::move(group));
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::cerr << "Error reading configuration " << path << ": "
+                  << e.what() << "\n";
+    }
+}
+
+void addSettings(const std::string& path, const SensorData& object,
+                 Settings& settings)
+{
+    auto config = object.find(std::string(configurationPrefix) +
+                              "ExpManager");
+    if (config == object.end())
+    {
+        return;
+    }
+    try
+    {
+        settings.notifyPaths =
+            getArray<std::string>(config->second, "NotifyPaths");
+        std::optional<double> window =
+            getDouble(config->second, "PublishWindowMs");
+        if (window && *window >= 0 && *window <= maxPublishWindowMs)
+        {
+            settings.publishWindowMs = static_cast<unsigned int>(*window);
+        }
+        else if (window)
+        {
+            std::cerr << "Ignoring PublishWindowMs " << *window << " of "
+                      << path << "\n";
+        }
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::cerr << "Error reading configuration " << path << ": "
+                  << e.what() << "\n";
+    }
+}
+
+// a controller runs in every zone it names, zones without a Pid.Zone
+// configuration of their own keep the defaults
+void assignControllers(std::vector<ZoneDescriptor>& zones,
+                       std::vector<ControllerDescriptor>&& controllers)
+{
+    for (ControllerDescriptor& controller : controllers)
+    {
+        for (const std::string& zoneName : controller.zones)
+        {
+            auto zone = std::find_if(zones.begin(), zones.end(),
+                                     [&zoneName](const ZoneDescriptor& zone) {
+                                         return zone.name == zoneName;
+                                     });
+            if (zone == zones.end())
+            {
+                zone = zones.emplace(zones.end());
+                zone->name = zoneName;
+            }
+            zone->controllers.emplace_back(controller);
+        }
+    }
+}
+
+// SAX events of flattened.json, an object of configuration objects keyed by
+// path, each an object of interfaces holding their properties. Properties
+// are collected for one configuration object and handed to addSensors,
+// addControls, addRedundancy and addSettings when it closes. Anything nested
+// deeper than an array of a property is skipped.
+class ConfigurationHandler
+{
+  public:
+    using json = nlohmann::json;
+
+    ConfigurationHandler(std::vector<SensorDescriptor>& sensors,
+                         std::vector<ZoneDescriptor>& zones,
+                         std::vector<ControllerDescriptor>& controllers,
+                         std::vector<RedundancyDescriptor>& groups,
+                         Settings& settings) :
+        sensors(sensors),
+        zones(zones), controllers(controllers), groups(groups),
+        settings(settings)
+    {
+    }
+
+    bool null()
+    {
+        return true;
+    }
+    bool boolean(bool val)
+    {
+        return value(val);
+    }
+    bool number_integer(json::number_integer_t val)
+    {
+        if (inPropertyArray())
+        {
+            arrayNumbers.push_back(val);
+            return true;
+        }
+        return value(val);
+    }
+    bool number_unsigned(json::number_unsigned_t val)
+    {
+        if (inPropertyArray())
+        {
+            arrayNumbers.push_back(val);
+            return true;
+        }
+        return value(val);
+    }
+    bool number_float(json::number_float_t val, const json::string_t&)
+    {
+        if (inPropertyArray())
+        {
+            arrayNumbers.push_back(val);
+            return true;
+        }
+        return value(val);
+    }
+    bool string(json::string_t& val)
+    {
+        if (inPropertyArray())
+        {
+            arrayValues.emplace_back(std::move(val));
+            return true;
+        }
+        return value(std::move(val));
+    }
+    bool binary(json::binary_t&)
+    {
+        return true;
+    }
+    bool start_object(std::size_t)
+    {
+        depth++;
+        return true;
+    }
+    bool end_object()
+    {
+        if (depth == interfaceDepth)
+        {
+            addSensors(path, object, sensors);
+            addControls(path, object, zones, controllers);
+            addRedundancy(path, object, groups);
+            addSettings(path, object, settings);
+            object.clear();
+        }
+        depth--;
+        return true;
+    }
+    bool start_array(std::size_t)
+    {
+        depth++;
+        if (depth == propertyDepth + 1)
+        {
+            inArray = true;
+            arrayValues.clear();
+            arrayNumbers.clear();
+        }
+        return true;
+    }
+    bool end_array()
+    {
+        if (inPropertyArray())
+        {
+            inArray = false;
+            if (arrayNumbers.empty())
+            {
+                object[interface][property] = std::move(arrayValues);
+            }
+            else
+            {
+                object[interface][property] = std::move(arrayNumbers);
+            }
+            arrayValues.clear();
+            arrayNumbers.clear();
+        }
+        depth--;
+        return true;
+    }
+    bool key(json::string_t& val)
+    {
+        if (depth == pathDepth)
+        {
+            path = std::move(val);
+        }
+        else if (depth == interfaceDepth)
+        {
+            interface = std::move(val);
+        }
+        else if (depth == propertyDepth)
+        {
+            property = std::move(val);
+        }
+        return true;
+    }
+    bool parse_error(std::size_t position, const std::string&,
+                     const json::exception& ex)
+    {
+        std::cerr << "Error parsing configuration at byte " << position
+                  << ": " << ex.what() << "\n";
+        return false;
+    }
+
+  private:
+    // nesting of the objects whose keys are paths, interfaces, properties
+    static constexpr size_t pathDepth = 1;
+    static constexpr size_t interfaceDepth = 2;
+    static constexpr size_t propertyDepth = 3;
+
+    std::vector<SensorDescriptor>& sensors;
+    std::vector<ZoneDescriptor>& zones;
+    std::vector<ControllerDescriptor>& controllers;
+    std::vector<RedundancyDescriptor>& groups;
+    Settings& settings;
+    size_t depth = 0;
+    bool inArray = false;
+    std::string path;
+    std::string interface;
+    std::string property;
+    SensorData object;
+    std::vector<std::string> arrayValues;
+    std::vector<double> arrayNumbers;
+
+    // an element of an array holding a property's value
+    bool inPropertyArray(void) const
+    {
+        return depth == propertyDepth + 1 && inArray;
+    }
+
+    template <typename T>
+    bool value(T&& val)
+    {
+        if (depth == propertyDepth)
+        {
+            object[interface][property] = std::forward<T>(val);
+        }
+        return true;
+    }
+};
+} // namespace
+
+bool parseConfiguration(const std::string& path,
+                        std::vector<SensorDescriptor>& sensors,
+                        std::vector<ZoneDescriptor>& zones,
+                        std::vector<RedundancyDescriptor>& groups,
+                        Settings& settings)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno)
+                  << "\n";
+        return false;
+    }
+    struct stat fileInfo = {};
+    if (fstat(fd, &fileInfo) < 0 || fileInfo.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(fileInfo.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        std::cerr << "Failed to map " << path << ": " << std::strerror(errno)
+                  << "\n";
+        return false;
+    }
+
+    const char* begin = static_cast<const char*>(mapped);
+    std::vector<ControllerDescriptor> controllers;
+    ConfigurationHandler handler(sensors, zones, controllers, groups,
+                                 settings);
+    bool parsed = nlohmann::json::sax_parse(begin, begin + size, &handler);
+    munmap(mapped, size);
+    assignControllers(zones, std::move(controllers));
+    return parsed;
+}
+} // namespace sensorconfig
@@ -0,0 +1,139 @@
+#include "SensorInput.hpp"
+
+#ifdef HAVE_IO_URING
+#include "InputRing.hpp"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <string_view>
+
+// large enough for a sysfs attribute or a small /etc/sensor in one pread
+static constexpr size_t initialBufferSize = 4096;
+
+SensorInput::SensorInput(const std::string& path) :
+    path(path), buffer(initialBufferSize)
+{
+    boost::system::error_code ec;
+    openInput(ec);
+}
+
+SensorInput::~SensorInput()
+{
+#ifdef HAVE_IO_URING
+    if (prefetchState == PrefetchState::queued)
+    {
+        // the ring holds a pointer to this input and its buffer
+        InputRing::getRing()->submit();
+    }
+#endif
+    closeInput();
+}
+
+void SensorInput::prefetch(void)
+{
+#ifdef HAVE_IO_URING
+    InputRing* ring = InputRing::getRing();
+    if (ring == nullptr || fd < 0 || prefetchState != PrefetchState::idle)
+    {
+        return;
+    }
+    if (ring->queue(*this, fd, buffer.data(), buffer.size()))
+    {
+        prefetchState = PrefetchState::queued;
+    }
+#endif
+}
+
+void SensorInput::completePrefetch(int result)
+{
+    if (result < 0)
+    {
+        // read() retries with pread and reports the error from there
+        prefetchState = PrefetchState::idle;
+        return;
+    }
+    prefetched = static_cast<size_t>(result);
+    prefetchState = PrefetchState::done;
+}
+
+bool SensorInput::openInput(boost::system::error_code& ec)
+{
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        ec = boost::system::error_code(errno, boost::system::system_category());
+        return false;
+    }
+    return true;
+}
+
+void SensorInput::closeInput(void)
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+std::string_view SensorInput::read(boost::system::error_code& ec)
+{
+    ec.clear();
+    if (fd < 0 && !openInput(ec))
+    {
+        return std::string_view();
+    }
+
+    size_t total = 0;
+#ifdef HAVE_IO_URING
+    if (prefetchState == PrefetchState::queued)
+    {
+        InputRing::getRing()->submit();
+    }
+#endif
+    if (prefetchState == PrefetchState::done)
+    {
+        prefetchState = PrefetchState::idle;
+        total = prefetched;
+        if (total < buffer.size())
+        {
+            return std::string_view(buffer.data(), total);
+        }
+    }
+    // a prefetch that never completed leaves the buffer to this read
+    prefetchState = PrefetchState::idle;
+
+    while (true)
+    {
+        if (total == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+        size_t space = buffer.size() - total;
+        ssize_t bytes = pread(fd, buffer.data() + total, space,
+                              static_cast<off_t>(total));
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ec = boost::system::error_code(errno,
+                                           boost::system::system_category());
+            closeInput();
+            return std::string_view();
+        }
+        total += static_cast<size_t>(bytes);
+        // a short read is the end of a regular file or sysfs attribute, so
+        // the common case is a single pread
+        if (static_cast<size_t>(bytes) < space)
+        {
+            break;
+        }
+    }
+    return std::string_view(buffer.data(), total);
+}
@@ -0,0 +1,71 @@
+#include "SensorPublisher.hpp"
+
+#include "sensor.hpp"
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <vector>
+
+static SensorPublisher* publisher = nullptr;
+
+SensorPublisher::SensorPublisher(boost::asio::io_service& io,
+                                 unsigned int windowMs) :
+    io(io),
+    timer(io), windowMs(windowMs)
+{
+}
+
+SensorPublisher& SensorPublisher::create(boost::asio::io_service& io,
+                                         unsigned int windowMs)
+{
+    // never destroyed, like the poll scheduler it has to outlive the sensors
+    if (publisher == nullptr)
+    {
+        publisher = new SensorPublisher(io, windowMs);
+    }
+    return *publisher;
+}
+
+SensorPublisher* SensorPublisher::get(void)
+{
+    return publisher;
+}
+
+void SensorPublisher::add(Sensor* sensor)
+{
+    dirty.push_back(sensor);
+    if (flushPending)
+    {
+        return;
+    }
+    flushPending = true;
+    if (windowMs == 0)
+    {
+        io.post([this]() { flush(); });
+        return;
+    }
+    timer.expires_from_now(boost::posix_time::milliseconds(windowMs));
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return; // we're being canceled
+        }
+        flush();
+    });
+}
+
+void SensorPublisher::remove(Sensor* sensor)
+{
+    dirty.erase(std::remove(dirty.begin(), dirty.end(), sensor), dirty.end());
+}
+
+void SensorPublisher::flush(void)
+{
+    flushPending = false;
+    flushing.swap(dirty);
+    for (Sensor* sensor : flushing)
+    {
+        sensor->publishValue();
+    }
+    flushing.clear();
+}
@@ -0,0 +1,120 @@
+#include "SensorRegistry.hpp"
+
+#include "sensor.hpp"
+
+#include <boost/algorithm/string/replace.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+
+SensorRegistry& SensorRegistry::get(void)
+{
+    // never destroyed, sensors held in statics unregister at exit
+    static SensorRegistry* registry = new SensorRegistry();
+    return *registry;
+}
+
+SensorRegistry::SensorId SensorRegistry::add(Sensor* sensor)
+{
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+    tombstones.erase(sensor->name);
+    SensorId id;
+    if (!freeIds.empty())
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+        sensors[id] = sensor;
+    }
+    else
+    {
+        id = sensors.size();
+        sensors.push_back(sensor);
+        owners.emplace_back();
+        values.push_back(nan);
+        lastValues.push_back(nan);
+        hysteresisTrigger.push_back(0);
+        hysteresisPublish.push_back(0);
+        for (std::vector<double>& slot : thresholdValues)
+        {
+            slot.push_back(nan);
+        }
+        alarms.push_back(0);
+        pendingAlarms.push_back(0);
+        generations.push_back(0);
+        timestamps.push_back(0);
+        return id;
+    }
+
+    values[id] = nan;
+    lastValues[id] = nan;
+    hysteresisTrigger[id] = 0;
+    hysteresisPublish[id] = 0;
+    for (std::vector<double>& slot : thresholdValues)
+    {
+        slot[id] = nan;
+    }
+    alarms[id] = 0;
+    pendingAlarms[id] = 0;
+    generations[id] = 0;
+    timestamps[id] = 0;
+    return id;
+}
+
+void SensorRegistry::remove(SensorId id)
+{
+    if (id >= sensors.size() || sensors[id] == nullptr)
+    {
+        return;
+    }
+    Sensor* sensor = sensors[id];
+    sensors[id] = nullptr;
+    freeIds.push_back(id);
+    for (const Sensor* other : sensors)
+    {
+        if (other != nullptr && other->name == sensor->name)
+        {
+            return; // replaced, the name lives on
+        }
+    }
+    tombstones[sensor->name] = ++generation;
+}
+
+void SensorRegistry::own(std::shared_ptr<Sensor> sensor)
+{
+    for (const Sensor* other : sensors)
+    {
+        if (other != nullptr && other != sensor.get() &&
+            other->name == sensor->name)
+        {
+            std::cerr << "Sensor " << sensor->name
+                      << " created before the old one was released\n";
+            break;
+        }
+    }
+    owners[sensor->id] = std::move(sensor);
+}
+
+void SensorRegistry::release(const std::string& name)
+{
+    std::string sensorName = boost::replace_all_copy(name, " ", "_");
+    for (SensorId id = 0; id < sensors.size(); id++)
+    {
+        if (sensors[id] != nullptr && sensors[id]->name == sensorName)
+        {
+            // frees id through the sensor's destructor
+            owners[id] = nullptr;
+        }
+    }
+}
+
+void SensorRegistry::touch(SensorId id)
+{
+    generations[id] = ++generation;
+    timestamps[id] = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count());
+}
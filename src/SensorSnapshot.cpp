@@ -0,0 +1,495 @@
+#include "SensorSnapshot.hpp"
+
+#include "ReadingParser.hpp"
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+
+static constexpr size_t warnAfterErrorCount = 10;
+
+// from linux/magic.h
+static constexpr long sysfsMagic = 0x62656572;
+
+static boost::container::flat_map<std::string, std::weak_ptr<SensorSnapshot>>
+    snapshots;
+
+SensorSnapshot::SensorSnapshot(boost::asio::io_service& io,
+                               const std::string& path) :
+    io(io),
+    input(path), scheduler(PollScheduler::getScheduler(io)), path(path),
+    notifyFd(io)
+{
+    binary.open(path);
+}
+
+SensorSnapshot::~SensorSnapshot()
+{
+    stopNotify();
+    for (const auto& [_, subscriber] : subscribers)
+    {
+        scheduler.remove(subscriber.task);
+    }
+}
+
+std::shared_ptr<SensorSnapshot>
+    SensorSnapshot::getSnapshot(boost::asio::io_service& io,
+                                const std::string& path)
+{
+    std::weak_ptr<SensorSnapshot>& weakRef = snapshots[path];
+    std::shared_ptr<SensorSnapshot> snapshot = weakRef.lock();
+    if (!snapshot)
+    {
+        snapshot = std::make_shared<SensorSnapshot>(io, path);
+        weakRef = snapshot;
+    }
+    return snapshot;
+}
+
+void SensorSnapshot::subscribe(const std::string& key, const void* owner,
+                               unsigned int pollMs, Callback&& callback)
+{
+    removeSubscriber(key);
+    Subscriber& subscriber = subscribers[key];
+    subscriber.owner = owner;
+    subscriber.callback = std::move(callback);
+    subscriber.removed = false;
+    subscriber.pollMs = pollMs;
+    subscriber.slot = binary.findSlot(key);
+    if (mode == UpdateMode::notify)
+    {
+        // nothing may change for a while, hand out the current value
+        postNotify();
+    }
+    else
+    {
+        addTask(key, subscriber);
+    }
+    updateRefreshMs();
+}
+
+void SensorSnapshot::addTask(const std::string& key, Subscriber& subscriber)
+{
+    subscriber.task = scheduler.add(
+        subscriber.pollMs, PollScheduler::phaseFor(key, subscriber.pollMs),
+        [this, key]() { poll(key); },
+        [this]() { prepare(); });
+}
+
+void SensorSnapshot::unsubscribe(const std::string& key, const void* owner)
+{
+    auto findSubscriber = subscribers.find(key);
+    if (findSubscriber == subscribers.end() ||
+        findSubscriber->second.owner != owner)
+    {
+        return;
+    }
+    removeSubscriber(key);
+}
+
+void SensorSnapshot::removeSubscriber(const std::string& key)
+{
+    auto findSubscriber = subscribers.find(key);
+    if (findSubscriber == subscribers.end())
+    {
+        return;
+    }
+    scheduler.remove(findSubscriber->second.task);
+    if (polling)
+    {
+        // the callback may be the one running, erase it once it returned
+        findSubscriber->second.removed = true;
+        pendingRemoval = true;
+        return;
+    }
+    subscribers.erase(findSubscriber);
+    updateRefreshMs();
+}
+
+void SensorSnapshot::setPollRate(const std::string& key, const void* owner,
+                                 unsigned int pollMs)
+{
+    auto findSubscriber = subscribers.find(key);
+    if (findSubscriber == subscribers.end() || findSubscriber->second.removed ||
+        findSubscriber->second.owner != owner ||
+        findSubscriber->second.pollMs == pollMs)
+    {
+        return;
+    }
+    findSubscriber->second.pollMs = pollMs;
+    if (findSubscriber->second.task != noTask)
+    {
+        scheduler.setPeriod(findSubscriber->second.task, pollMs,
+                            PollScheduler::phaseFor(key, pollMs));
+    }
+    updateRefreshMs();
+}
+
+SensorSnapshot::UpdateMode SensorSnapshot::setUpdateMode(UpdateMode newMode)
+{
+    if (newMode == mode)
+    {
+        return mode;
+    }
+    if (newMode == UpdateMode::notify)
+    {
+        if (!startNotify())
+        {
+            return mode;
+        }
+        mode = UpdateMode::notify;
+        for (auto& [_, subscriber] : subscribers)
+        {
+            scheduler.remove(subscriber.task);
+            subscriber.task = noTask;
+        }
+        // pick up whatever changed before the watch was in place
+        postNotify();
+        return mode;
+    }
+
+    stopNotify();
+    mode = UpdateMode::poll;
+    for (auto& [key, subscriber] : subscribers)
+    {
+        if (!subscriber.removed)
+        {
+            addTask(key, subscriber);
+        }
+    }
+    return mode;
+}
+
+void SensorSnapshot::updateRefreshMs(void)
+{
+    refreshMs = std::numeric_limits<unsigned int>::max();
+    for (const auto& [_, subscriber] : subscribers)
+    {
+        if (!subscriber.removed)
+        {
+            refreshMs = std::min(refreshMs, subscriber.pollMs);
+        }
+    }
+}
+
+void SensorSnapshot::openBinary(void)
+{
+    binary.open(path);
+    for (auto& [key, subscriber] : subscribers)
+    {
+        subscriber.slot = binary.findSlot(key);
+    }
+}
+
+void SensorSnapshot::refresh(void)
+{
+    if (binary.isOpen())
+    {
+        // slots are copied as they are handed out, only follow a producer
+        // that replaced the file with a new layout
+        readErr.clear();
+        if (binary.replaced(path))
+        {
+            openBinary();
+        }
+        return;
+    }
+
+    for (auto& [_, subscriber] : subscribers)
+    {
+        subscriber.response = std::string_view();
+    }
+
+    std::string_view buffer = input.read(readErr);
+    if (readErr)
+    {
+        errCount++;
+        // only print once
+        if (errCount == warnAfterErrorCount)
+        {
+            std::cerr << "Failure to read sensor source " << path
+                      << " ec:" << readErr << "\n";
+        }
+        return;
+    }
+    errCount = 0;
+    // the source did not exist yet when this was created and the producer
+    // wrote it in the binary format
+    if (buffer.size() >= sizeof(binsnapshot::magic) &&
+        std::memcmp(buffer.data(), &binsnapshot::magic,
+                    sizeof(binsnapshot::magic)) == 0)
+    {
+        openBinary();
+        return;
+    }
+    reading::parseLines(
+        buffer, [this](std::string_view key, std::string_view value) {
+            Subscriber* subscriber = findSubscriber(key);
+            if (subscriber != nullptr)
+            {
+                // later lines for the same key win
+                subscriber->response = value;
+            }
+        });
+}
+
+void SensorSnapshot::prepare(void)
+{
+    // subscribers share one read of the source per shortest period, so a
+    // value is at most that old when it is handed out
+    uint64_t tick = scheduler.getTick();
+    if (!readTick || (tick - *readTick) * PollScheduler::tickMs >= refreshMs)
+    {
+        readTick = tick;
+        refreshPending = true;
+        // lets the read be submitted together with every other source due
+        // in this batch
+        if (!binary.isOpen())
+        {
+            input.prefetch();
+        }
+    }
+}
+
+void SensorSnapshot::poll(const std::string& key)
+{
+    if (refreshPending)
+    {
+        refreshPending = false;
+        refresh();
+    }
+
+    auto findSubscriber = subscribers.find(key);
+    if (findSubscriber == subscribers.end() || findSubscriber->second.removed)
+    {
+        return;
+    }
+    polling = true;
+    deliver(findSubscriber->second);
+    polling = false;
+    erasePending();
+}
+
+void SensorSnapshot::deliver(Subscriber& subscriber)
+{
+    std::optional<double> value;
+    if (binary.isOpen())
+    {
+        binsnapshot::Slot slot = {};
+        if (subscriber.slot && binary.readSlot(*subscriber.slot, slot) &&
+            slot.status == binsnapshot::SlotStatus::ok)
+        {
+            value = slot.value;
+        }
+    }
+    else
+    {
+        double parsed = 0;
+        if (!readErr && reading::parseValue(subscriber.response, parsed) ==
+                            reading::ParseStatus::ok)
+        {
+            value = parsed;
+        }
+    }
+    subscriber.callback(readErr, value);
+}
+
+void SensorSnapshot::erasePending(void)
+{
+    if (!pendingRemoval)
+    {
+        return;
+    }
+    pendingRemoval = false;
+    for (auto it = subscribers.begin(); it != subscribers.end();)
+    {
+        if (it->second.removed)
+        {
+            it = subscribers.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+    updateRefreshMs();
+}
+
+SensorSnapshot::Subscriber* SensorSnapshot::findSubscriber(std::string_view key)
+{
+    // heterogeneous lookup so parsing does not build a std::string per key
+    auto it = std::lower_bound(
+        subscribers.begin(), subscribers.end(), key,
+        [](const auto& entry, std::string_view k) { return entry.first < k; });
+    if (it == subscribers.end() || it->first != key)
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+bool SensorSnapshot::startNotify(void)
+{
+    if (binary.isOpen())
+    {
+        // writes through a mapping raise no inotify event
+        std::cerr << "Binary sensor source " << path << " is polled\n";
+        return false;
+    }
+
+    struct statfs fsInfo = {};
+    if (statfs(path.c_str(), &fsInfo) < 0)
+    {
+        std::cerr << "Cannot watch sensor source " << path << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    int fd = -1;
+    sysfsNotify = fsInfo.f_type == sysfsMagic;
+    if (sysfsNotify)
+    {
+        // POLLPRI is reported per open file, it has to be the descriptor the
+        // value is read from
+        boost::system::error_code ec;
+        input.read(ec);
+        if (!ec)
+        {
+            fd = fcntl(input.getFd(), F_DUPFD_CLOEXEC, 0);
+        }
+    }
+    else
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0 && inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0)
+    {
+        std::cerr << "Cannot watch sensor source " << path << ": "
+                  << std::strerror(errno) << "\n";
+        return false;
+    }
+    notifyFd.assign(fd);
+    waitNotify();
+    return true;
+}
+
+void SensorSnapshot::stopNotify(void)
+{
+    if (notifyFd.is_open())
+    {
+        notifyFd.close();
+    }
+}
+
+void SensorSnapshot::waitNotify(void)
+{
+    auto waitType = sysfsNotify
+                        ? boost::asio::posix::stream_descriptor::wait_error
+                        : boost::asio::posix::stream_descriptor::wait_read;
+    notifyFd.async_wait(waitType, [this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return; // we're being destroyed or switched back to polling
+        }
+        else if (ec)
+        {
+            std::cerr << "Sensor source " << path << " notify error "
+                      << ec.message() << ", polling instead\n";
+            setUpdateMode(UpdateMode::poll);
+            return;
+        }
+        handleNotify();
+    });
+}
+
+void SensorSnapshot::handleNotify(void)
+{
+    if (!sysfsNotify)
+    {
+        bool watchGone = false;
+        ssize_t bytes = 0;
+        while ((bytes = read(notifyFd.native_handle(), notifyBuf.data(),
+                             notifyBuf.size())) > 0)
+        {
+            for (ssize_t offset = 0; offset < bytes;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(
+                    notifyBuf.data() + offset);
+                // the file was deleted or its filesystem unmounted
+                watchGone = watchGone || (event->mask & IN_IGNORED);
+                offset += static_cast<ssize_t>(sizeof(inotify_event)) +
+                          static_cast<ssize_t>(event->len);
+            }
+        }
+        if (watchGone)
+        {
+            std::cerr << "Sensor source " << path
+                      << " is no longer watched, polling instead\n";
+            setUpdateMode(UpdateMode::poll);
+            return;
+        }
+    }
+
+    notifyAll();
+    // the sysfs descriptor was reopened after a failed read, so POLLPRI on
+    // the dup would no longer be rearmed
+    if (sysfsNotify && readErr)
+    {
+        std::cerr << "Sensor source " << path
+                  << " failed to read, polling instead\n";
+        setUpdateMode(UpdateMode::poll);
+        return;
+    }
+    waitNotify();
+}
+
+void SensorSnapshot::postNotify(void)
+{
+    if (notifyPosted)
+    {
+        return;
+    }
+    notifyPosted = true;
+    std::weak_ptr<SensorSnapshot> weakRef = weak_from_this();
+    io.post([weakRef]() {
+        std::shared_ptr<SensorSnapshot> self = weakRef.lock();
+        if (self)
+        {
+            self->notifyPosted = false;
+            if (self->mode == UpdateMode::notify)
+            {
+                self->notifyAll();
+            }
+        }
+    });
+}
+
+void SensorSnapshot::notifyAll(void)
+{
+    refresh();
+    polling = true;
+    for (auto& [_, subscriber] : subscribers)
+    {
+        if (!subscriber.removed)
+        {
+            deliver(subscriber);
+        }
+    }
+    polling = false;
+    erasePending();
+}
@@ -24,7 +24,6 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <fstream>
-#include <gpiod.hpp>
 #include <iostream>
 #include <istream>
 #include <limits>
@@ -37,25 +36,23 @@
 #include <utility>
 #include <vector>
 
-static constexpr unsigned int pwmPollMs = 500;
 static constexpr size_t warnAfterErrorCount = 10;
 
 TachSensor::TachSensor(const std::string& path, const std::string& objectType,
                        sdbusplus::asio::object_server& objectServer,
                        std::shared_ptr<sdbusplus::asio::connection>& conn,
                        std::unique_ptr<PresenceSensor>&& presenceSensor,
-                       std::optional<RedundancySensor>* redundancy,
                        boost::asio::io_service& io, const std::string& fanName,
                        std::vector<thresholds::Threshold>&& _thresholds,
                        const std::string& sensorConfiguration,
-                       const std::pair<size_t, size_t>& limits) :
+                       const std::pair<size_t, size_t>& limits,
+                       unsigned int pollRateMs) :
     Sensor(boost::replace_all_copy(fanName, " ", "_"), std::move(_thresholds),
            sensorConfiguration, objectType, limits.second, limits.first,
            sdbusplus::xyz::openbmc_project::Sensor::server::Value::Unit::RPMS),
-    objServer(objectServer), redundancy(redundancy),
-    presence(std::move(presenceSensor)),
-    inputDev(io, open(path.c_str(), O_RDONLY)), waitTimer(io), path(path),
-    errCount(0)
+    objServer(objectServer), presence(std::move(presenceSensor)),
+    snapshot(SensorSnapshot::getSnapshot(io, path)), path(path), errCount(0),
+    pollRateMs(pollRateMs)
 {
     sensorInterface = objectServer.add_interface(
         "/xyz/openbmc_project/sensors/fan_tach/" + name,
@@ -84,8 +81,15 @@ TachSensor::TachSensor(const std::string& path, const std::string& objectType,
                                        "xyz.openbmc_project.Inventory.Item");
         itemIface->register_property("PrettyName",
                                      std::string()); // unused property
-        itemIface->register_property("Present", true);
+        itemIface->register_property("Present", presence->getValue());
         itemIface->initialize();
+        presence->onChange([this](bool present) {
+            itemIface->set_property("Present", present);
+            if (!present)
+            {
+                updateValue(std::numeric_limits<double>::quiet_NaN());
+            }
+        });
         itemAssoc = objectServer.add_interface(
             "/xyz/openbmc_project/inventory/" + name, association::interface);
         itemAssoc->register_property(
@@ -102,9 +106,14 @@ TachSensor::TachSensor(const std::string& path, const std::string& objectType,
 
 TachSensor::~TachSensor()
 {
-    // close the input dev to cancel async operations
-    inputDev.close();
-    waitTimer.cancel();
+    if (redundancyFailed)
+    {
+        for (const RedundancyMember& member : redundancy)
+        {
+            member.group->update(member.child, false);
+        }
+    }
+    snapshot->unsubscribe(name, this);
     objServer.remove_interface(thresholdInterfaceWarning);
     objServer.remove_interface(thresholdInterfaceCritical);
     objServer.remove_interface(sensorInterface);
@@ -115,55 +124,32 @@ TachSensor::~TachSensor()
 
 void TachSensor::setupRead(void)
 {
-    boost::asio::async_read_until(
-        inputDev, readBuf, '\n',
-        [&](const boost::system::error_code& ec,
-            std::size_t /*bytes_transfered*/) { handleResponse(ec); });
+    snapshot->subscribe(name, this, pollRateMs,
+                        [this](const boost::system::error_code& ec,
+                               const std::optional<double>& reading) {
+                            handleResponse(ec, reading);
+                        });
 }
 
-void TachSensor::handleResponse(const boost::system::error_code& err)
+void TachSensor::handleResponse(const boost::system::error_code& err,
+                                const std::optional<double>& reading)
 {
-    if (err == boost::system::errc::bad_file_descriptor)
+    // Present itself is updated by the presence callback
+    bool missing = presence && !presence->getValue();
+    if (missing)
     {
-        return; // we're being destroyed
+        updateValue(std::numeric_limits<double>::quiet_NaN());
     }
-    bool missing = false;
-    size_t pollTime = pwmPollMs;
-    if (presence)
-    {
-        if (!presence->getValue())
-        {
-            updateValue(std::numeric_limits<double>::quiet_NaN());
-            missing = true;
-            pollTime = sensorFailedPollTimeMs;
-        }
-        itemIface->set_property("Present", !missing);
-    }
-    std::istream responseStream(&readBuf);
     if (!missing)
     {
         if (!err)
         {
-            std::string response;
-            try
+            if (reading)
             {
-                std::string line;
-                while (std::getline(responseStream, line))
-                {
-                    std::string key{""}, value{""};
-                    std::istringstream kv(line);
-                    std::getline(kv, key, '=');
-                    std::getline(kv, value);
-                    if (this->name == key) {
-                        response = value;
-                    }
-                }
-                double nvalue = std::stod(response);
-                responseStream.clear();
-                updateValue(nvalue);
+                updateValue(*reading);
                 errCount = 0;
             }
-            catch (const std::invalid_argument&)
+            else
             {
                 errCount++;
             }
@@ -177,7 +163,6 @@ void TachSensor::handleResponse(const boost::system::error_code& err)
             }
             else
             {
-                pollTime = sensorFailedPollTimeMs;
                 errCount++;
             }
         }
@@ -192,22 +177,11 @@ void TachSensor::handleResponse(const boost::system::error_code& err)
             updateValue(0);
         }
     }
-    responseStream.clear();
-    inputDev.close();
-    int fd = open(path.c_str(), O_RDONLY);
-    if (fd < 0)
+
+    if (adaptPollRate(pollRateMs))
     {
-        return; // we're no longer valid
+        snapshot->setPollRate(name, this, pollRateMs);
     }
-    inputDev.assign(fd);
-    waitTimer.expires_from_now(boost::posix_time::milliseconds(pollTime));
-    waitTimer.async_wait([&](const boost::system::error_code& ec) {
-        if (ec == boost::asio::error::operation_aborted)
-        {
-            return; // we're being canceled
-        }
-        setupRead();
-    });
 }
 
 void TachSensor::checkThresholds(void)
@@ -217,117 +191,101 @@ void TachSensor::checkThresholds(void)
         return;
     }
 
-    bool status = thresholds::checkThresholds(this);
-
-    if (redundancy && *redundancy)
+    bool failed = !thresholds::checkThresholds(this);
+    if (failed == redundancyFailed)
     {
-        (*redundancy)
-            ->update("/xyz/openbmc_project/sensors/fan_tach/" + name, !status);
+        return;
+    }
+    redundancyFailed = failed;
+    for (const RedundancyMember& member : redundancy)
+    {
+        member.group->update(member.child, failed);
     }
 }
 
-PresenceSensor::PresenceSensor(const std::string& gpioName, bool inverted,
-                               boost::asio::io_service& io,
-                               const std::string& name) :
-    inverted(inverted),
-    gpioLine(gpiod::find_line(gpioName)), gpioFd(io), name(name)
+bool TachSensor::joinRedundancy(RedundancySensor& group)
 {
-    if (!gpioLine)
+    std::optional<size_t> child = group.findChild(name);
+    if (!child)
     {
-        std::cerr << "Error requesting gpio: " << gpioName << "\n";
-        status = false;
-        return;
+        return false;
     }
-
-    try
+    redundancy.push_back({&group, *child});
+    if (redundancyFailed)
     {
-        gpioLine.request({"FanSensor", gpiod::line_request::EVENT_BOTH_EDGES,
-                          inverted ? gpiod::line_request::FLAG_ACTIVE_LOW : 0});
-        status = gpioLine.get_value();
-
-        int gpioLineFd = gpioLine.event_get_fd();
-        if (gpioLineFd < 0)
-        {
-            std::cerr << "Failed to get " << gpioName << " fd\n";
-            return;
-        }
-
-        gpioFd.assign(gpioLineFd);
+        group.update(*child, true);
     }
-    catch (std::system_error&)
+    return true;
+}
+
+PresenceSensor::PresenceSensor(const std::string& gpioName, bool inverted,
+                               boost::asio::io_service& io,
+                               const std::string& name) :
+    manager(PresenceManager::get(io)),
+    name(name)
+{
+    if (!manager.add(this, gpioName, inverted))
     {
-        std::cerr << "Error reading gpio: " << gpioName << "\n";
         status = false;
-        return;
     }
-
-    monitorPresence();
 }
 
 PresenceSensor::~PresenceSensor()
 {
-    gpioFd.close();
-    gpioLine.release();
+    manager.remove(this);
 }
 
-void PresenceSensor::monitorPresence(void)
+void PresenceSensor::update(bool present, bool edge)
 {
-    gpioFd.async_wait(boost::asio::posix::stream_descriptor::wait_read,
-                      [this](const boost::system::error_code& ec) {
-                          if (ec == boost::system::errc::bad_file_descriptor)
-                          {
-                              return; // we're being destroyed
-                          }
-                          else if (ec)
-                          {
-                              std::cerr << "Error on presence sensor " << name
-                                        << " \n";
-                              ;
-                          }
-                          else
-                          {
-                              read();
-                          }
-                          monitorPresence();
-                      });
-}
-
-void PresenceSensor::read(void)
-{
-    gpioLine.event_read();
-    status = gpioLine.get_value();
-    // Read is invoked when an edge event is detected by monitorPresence
-    if (status)
+    if (present == status)
     {
-        logFanInserted(name);
+        return;
     }
-    else
+    status = present;
+    if (edge)
     {
-        logFanRemoved(name);
+        if (status)
+        {
+            logFanInserted(name);
+        }
+        else
+        {
+            logFanRemoved(name);
+        }
+    }
+    if (changed)
+    {
+        changed(status);
     }
 }
 
+void PresenceSensor::onChange(std::function<void(bool present)>&& callback)
+{
+    changed = std::move(callback);
+}
+
 bool PresenceSensor::getValue(void)
 {
     return status;
 }
 
-RedundancySensor::RedundancySensor(size_t count,
+RedundancySensor::RedundancySensor(const std::string& name, size_t count,
                                    const std::vector<std::string>& children,
                                    sdbusplus::asio::object_server& objectServer,
                                    const std::string& sensorConfiguration) :
     count(count),
+    children(children), failures(children.size(), false),
     iface(objectServer.add_interface(
-        "/xyz/openbmc_project/control/FanRedundancy/Tach",
+        "/xyz/openbmc_project/control/FanRedundancy/" + name,
         "xyz.openbmc_project.Control.FanRedundancy")),
     association(objectServer.add_interface(
-        "/xyz/openbmc_project/control/FanRedundancy/Tach",
+        "/xyz/openbmc_project/control/FanRedundancy/" + name,
         association::interface)),
     objectServer(objectServer)
 {
     createAssociation(association, sensorConfiguration);
     iface->register_property("Collection", children);
-    iface->register_property("Status", std::string("Full"));
+    iface->register_property("Status", std::string(state));
     iface->register_property("AllowedFailures", static_cast<uint8_t>(count));
     iface->initialize();
 }
@@ -336,28 +294,37 @@ RedundancySensor::~RedundancySensor()
     objectServer.remove_interface(association);
     objectServer.remove_interface(iface);
 }
-void RedundancySensor::update(const std::string& name, bool failed)
+std::optional<size_t>
+    RedundancySensor::findChild(const std::string& sensorName) const
 {
-    statuses[name] = failed;
-    size_t failedCount = 0;
-
-    std::string newState = redundancy::full;
-    for (const auto& status : statuses)
+    std::string path = "/xyz/openbmc_project/sensors/fan_tach/" + sensorName;
+    for (size_t ii = 0; ii < children.size(); ii++)
     {
-        if (status.second)
-        {
-            failedCount++;
-        }
-        if (failedCount > count)
+        if (children[ii] == path)
         {
-            newState = redundancy::failed;
-            break;
-        }
-        else if (failedCount)
-        {
-            newState = redundancy::degraded;
+            return ii;
         }
     }
+    return std::nullopt;
+}
+void RedundancySensor::update(size_t child, bool failed)
+{
+    if (failures[child] == failed)
+    {
+        return;
+    }
+    failures[child] = failed;
+    failedCount = failed ? failedCount + 1 : failedCount - 1;
+
+    const char* newState = redundancy::full;
+    if (failedCount > count)
+    {
+        newState = redundancy::failed;
+    }
+    else if (failedCount)
+    {
+        newState = redundancy::degraded;
+    }
     if (state != newState)
     {
         if (state == redundancy::full)
@@ -369,6 +336,6 @@ void RedundancySensor::update(const std::string& name, bool failed)
             logFanRedundancyRestored();
         }
         state = newState;
-        iface->set_property("Status", state);
+        iface->set_property("Status", std::string(state));
     }
 }
@@ -0,0 +1,114 @@
+#include "ThresholdEvaluator.hpp"
+
+#include "Thresholds.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace thresholds
+{
+namespace
+{
+constexpr unsigned int warningHigh = slot(Level::WARNING, Direction::HIGH);
+constexpr unsigned int warningLow = slot(Level::WARNING, Direction::LOW);
+constexpr unsigned int criticalHigh = slot(Level::CRITICAL, Direction::HIGH);
+constexpr unsigned int criticalLow = slot(Level::CRITICAL, Direction::LOW);
+
+// pointers hoisted out of the vectors once per batch
+struct Columns
+{
+    explicit Columns(const SensorRegistry& registry) :
+        values(registry.values.data()),
+        hysteresis(registry.hysteresisTrigger.data()),
+        warnHigh(registry.thresholdValues[warningHigh].data()),
+        warnLow(registry.thresholdValues[warningLow].data()),
+        critHigh(registry.thresholdValues[criticalHigh].data()),
+        critLow(registry.thresholdValues[criticalLow].data()),
+        alarms(registry.alarms.data()),
+        pendingAlarms(registry.pendingAlarms.data())
+    {
+    }
+
+    const double* values;
+    const double* hysteresis;
+    const double* warnHigh;
+    const double* warnLow;
+    const double* critHigh;
+    const double* critLow;
+    const uint8_t* alarms;
+    const uint8_t* pendingAlarms;
+};
+
+inline unsigned int bit(bool set, unsigned int index)
+{
+    return static_cast<unsigned int>(set) << index;
+}
+
+inline uint8_t transitions(const Columns& columns, size_t id,
+                           unsigned int alarms)
+{
+    double value = columns.values[id];
+    double hysteresis = columns.hysteresis[id];
+    double warnHigh = columns.warnHigh[id];
+    double warnLow = columns.warnLow[id];
+    double critHigh = columns.critHigh[id];
+    double critLow = columns.critLow[id];
+
+    unsigned int assert = bit(value >= warnHigh, warningHigh) |
+                          bit(value <= warnLow, warningLow) |
+                          bit(value >= critHigh, criticalHigh) |
+                          bit(value <= critLow, criticalLow);
+    unsigned int clear = bit(value < warnHigh - hysteresis, warningHigh) |
+                         bit(value > warnLow + hysteresis, warningLow) |
+                         bit(value < critHigh - hysteresis, criticalHigh) |
+                         bit(value > critLow + hysteresis, criticalLow);
+
+    return static_cast<uint8_t>(((alarms & ~clear) | assert) ^ alarms);
+}
+} // namespace
+
+uint8_t evaluate(const SensorRegistry& registry, SensorRegistry::SensorId id)
+{
+    return transitions(Columns(registry), id, registry.alarms[id]);
+}
+
+uint8_t evaluate(const SensorRegistry& registry, SensorRegistry::SensorId id,
+                 uint8_t alarms)
+{
+    return transitions(Columns(registry), id, alarms);
+}
+
+uint8_t evaluate(const SensorRegistry& registry,
+                 const SensorRegistry::SensorId* ids, size_t count,
+                 uint8_t* transitionsOut)
+{
+    Columns columns(registry);
+    uint8_t any = 0;
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        SensorRegistry::SensorId id = ids[ii];
+        uint8_t changed = transitions(
+            columns, id, columns.alarms[id] | columns.pendingAlarms[id]);
+        transitionsOut[ii] = changed;
+        any |= changed;
+    }
+    return any;
+}
+
+uint8_t evaluateRange(const SensorRegistry& registry,
+                      SensorRegistry::SensorId first, size_t count,
+                      uint8_t* transitionsOut)
+{
+    Columns columns(registry);
+    uint8_t any = 0;
+    for (size_t ii = 0; ii < count; ii++)
+    {
+        SensorRegistry::SensorId id = first + ii;
+        uint8_t changed = transitions(
+            columns, id, columns.alarms[id] | columns.pendingAlarms[id]);
+        transitionsOut[ii] = changed;
+        any |= changed;
+    }
+    return any;
+}
+} // namespace thresholds
@@ -1,18 +1,24 @@
 #include "Thresholds.hpp"
 
+#include "ConfigCache.hpp"
+#include "ThresholdEvaluator.hpp"
 #include "VariantVisitors.hpp"
 #include "sensor.hpp"
 
 #include <array>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
 #include <boost/lexical_cast.hpp>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -58,6 +64,12 @@ std::string toBusValue(const Direction& direction)
     }
 }
 
+static constexpr std::array<std::pair<Level, Direction>, 4> alarmSlots = {
+    {{Level::WARNING, Direction::HIGH},
+     {Level::WARNING, Direction::LOW},
+     {Level::CRITICAL, Direction::HIGH},
+     {Level::CRITICAL, Direction::LOW}}};
+
 bool parseThresholdsFromConfig(
     const SensorData& sensorData,
     std::vector<thresholds::Threshold>& thresholdVector,
@@ -115,17 +127,178 @@ bool parseThresholdsFromConfig(
     return true;
 }
 
-void persistThreshold(const std::string& path, const std::string& baseInterface,
-                      const thresholds::Threshold& threshold,
-                      std::shared_ptr<sdbusplus::asio::connection>& conn,
-                      size_t thresholdCount, const std::string& labelMatch)
+namespace
+{
+// configuration path, level, direction and label of a threshold
+using ThresholdKey = std::tuple<std::string, Level, Direction, std::string>;
+
+// threshold interfaces of every threshold found under the paths in
+// indexedPaths, so a write is a Set per matching interface instead of a
+// GetAll per candidate interface first
+boost::container::flat_map<ThresholdKey, std::vector<std::string>>
+    thresholdInterfaces;
+boost::container::flat_set<std::string> indexedPaths;
+// bumped by every change to a configuration, a fetch that saw it change
+// while in flight is thrown away and done again
+boost::container::flat_map<std::string, uint64_t> pathEpochs;
+// writes waiting for the index of their path
+boost::container::flat_map<std::string, std::vector<std::function<void(void)>>>
+    indexWaiters;
+bool configWatched = false;
+
+void eraseThresholdIndex(const std::string& path)
+{
+    auto begin = thresholdInterfaces.lower_bound(
+        ThresholdKey(path, Level::WARNING, Direction::HIGH, ""));
+    auto end = begin;
+    while (end != thresholdInterfaces.end() && std::get<0>(end->first) == path)
+    {
+        end++;
+    }
+    thresholdInterfaces.erase(begin, end);
+}
+
+void invalidateThresholdIndex(const std::string& path)
+{
+    pathEpochs[path]++;
+    if (indexedPaths.erase(path) != 0)
+    {
+        eraseThresholdIndex(path);
+    }
+}
+
+// drops the index of a configuration whose thresholds are added, removed or
+// edited in any way other than their value, which is what persistThreshold
+// writes itself
+void setupConfigMatch(const std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    if (configWatched)
+    {
+        return;
+    }
+    configWatched = true;
+    ConfigCache::get(conn).onChange(
+        [](const std::string& path, const std::string& interface,
+           const std::vector<std::string>& properties) {
+            if (!interface.empty() &&
+                (interface.find("Thresholds") == std::string::npos ||
+                 (properties.size() == 1 && properties.front() == "Value")))
+            {
+                return;
+            }
+            invalidateThresholdIndex(path);
+        });
+}
+
+void indexThreshold(
+    const std::string& path, const std::string& interface,
+    const boost::container::flat_map<std::string, BasicVariantType>& result)
+{
+    auto directionFind = result.find("Direction");
+    auto severityFind = result.find("Severity");
+    auto valueFind = result.find("Value");
+    if (valueFind == result.end() || severityFind == result.end() ||
+        directionFind == result.end())
+    {
+        std::cerr << "Malformed threshold in configuration\n";
+        return;
+    }
+    unsigned int severity =
+        std::visit(VariantToUnsignedIntVisitor(), severityFind->second);
+    std::string dir =
+        std::visit(VariantToStringVisitor(), directionFind->second);
+    std::string label;
+    auto labelFind = result.find("Label");
+    if (labelFind != result.end())
+    {
+        label = std::visit(VariantToStringVisitor(), labelFind->second);
+    }
+    for (const auto& [level, direction] : alarmSlots)
+    {
+        if (toBusValue(level) != severity || toBusValue(direction) != dir)
+        {
+            continue;
+        }
+        thresholdInterfaces[ThresholdKey(path, level, direction, label)]
+            .push_back(interface);
+        // sensors without a label write every threshold of a level and
+        // direction whatever its label
+        if (!label.empty())
+        {
+            thresholdInterfaces[ThresholdKey(path, level, direction, "")]
+                .push_back(interface);
+        }
+    }
+}
+
+void fetchThresholdIndex(
+    const std::shared_ptr<sdbusplus::asio::connection>& conn,
+    const std::string& path, const std::string& baseInterface,
+    size_t thresholdCount);
+
+// collects the GetAll replies of one configuration, the index is complete
+// once the last reply dropped its reference
+struct ThresholdIndexFetch
+{
+    ThresholdIndexFetch(
+        const std::shared_ptr<sdbusplus::asio::connection>& conn,
+        const std::string& path, const std::string& baseInterface,
+        size_t thresholdCount) :
+        conn(conn),
+        path(path), baseInterface(baseInterface),
+        thresholdCount(thresholdCount), epoch(pathEpochs[path])
+    {
+    }
+    ~ThresholdIndexFetch()
+    {
+        if (pathEpochs[path] != epoch)
+        {
+            // the configuration changed under the replies, the waiting
+            // writes go out once a fresh read completed
+            eraseThresholdIndex(path);
+            fetchThresholdIndex(conn, path, baseInterface, thresholdCount);
+            return;
+        }
+        // try again on the next write if the configuration could not be read
+        if (found)
+        {
+            indexedPaths.insert(path);
+        }
+        auto waiters = indexWaiters.find(path);
+        if (waiters == indexWaiters.end())
+        {
+            return;
+        }
+        std::vector<std::function<void(void)>> writes =
+            std::move(waiters->second);
+        indexWaiters.erase(waiters);
+        for (const auto& write : writes)
+        {
+            write();
+        }
+    }
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    std::string path;
+    std::string baseInterface;
+    size_t thresholdCount;
+    uint64_t epoch;
+    bool found = false;
+};
+
+void fetchThresholdIndex(
+    const std::shared_ptr<sdbusplus::asio::connection>& conn,
+    const std::string& path, const std::string& baseInterface,
+    size_t thresholdCount)
 {
+    auto fetch = std::make_shared<ThresholdIndexFetch>(conn, path,
+                                                       baseInterface,
+                                                       thresholdCount);
     for (size_t ii = 0; ii < thresholdCount; ii++)
     {
         std::string thresholdInterface =
             baseInterface + ".Thresholds" + std::to_string(ii);
         conn->async_method_call(
-            [&, path, threshold, thresholdInterface, labelMatch](
+            [fetch, thresholdInterface](
                 const boost::system::error_code& ec,
                 const boost::container::flat_map<std::string, BasicVariantType>&
                     result) {
@@ -133,62 +306,63 @@ void persistThreshold(const std::string& path, const std::string& baseInterface,
                 {
                     return; // threshold not supported
                 }
+                fetch->found = true;
+                indexThreshold(fetch->path, thresholdInterface, result);
+            },
+            entityManagerName, path, "org.freedesktop.DBus.Properties",
+            "GetAll", thresholdInterface);
+    }
+}
+} // namespace
 
-                if (!labelMatch.empty())
-                {
-                    auto labelFind = result.find("Label");
-                    if (labelFind == result.end())
-                    {
-                        std::cerr << "No label in threshold configuration\n";
-                        return;
-                    }
-                    std::string label =
-                        std::visit(VariantToStringVisitor(), labelFind->second);
-                    if (label != labelMatch)
+void persistThreshold(const std::string& path, const std::string& baseInterface,
+                      const thresholds::Threshold& threshold,
+                      std::shared_ptr<sdbusplus::asio::connection>& conn,
+                      size_t thresholdCount, const std::string& labelMatch)
+{
+    setupConfigMatch(conn);
+    auto write = [conn, key = ThresholdKey(path, threshold.level,
+                                           threshold.direction, labelMatch),
+                  value = threshold.value]() {
+        auto find = thresholdInterfaces.find(key);
+        if (find == thresholdInterfaces.end())
+        {
+            return; // threshold not supported
+        }
+        for (const std::string& interface : find->second)
+        {
+            conn->async_method_call(
+                [](const boost::system::error_code& ec) {
+                    if (ec)
                     {
-                        return;
+                        std::cerr << "Error setting threshold " << ec << "\n";
                     }
-                }
-
-                auto directionFind = result.find("Direction");
-                auto severityFind = result.find("Severity");
-                auto valueFind = result.find("Value");
-                if (valueFind == result.end() || severityFind == result.end() ||
-                    directionFind == result.end())
-                {
-                    std::cerr << "Malformed threshold in configuration\n";
-                    return;
-                }
-                unsigned int level = std::visit(VariantToUnsignedIntVisitor(),
-                                                severityFind->second);
-
-                std::string dir =
-                    std::visit(VariantToStringVisitor(), directionFind->second);
-                if ((toBusValue(threshold.level) != level) ||
-                    (toBusValue(threshold.direction) != dir))
-                {
-                    return; // not the droid we're looking for
-                }
+                },
+                entityManagerName, std::get<0>(key),
+                "org.freedesktop.DBus.Properties", "Set", interface, "Value",
+                std::variant<double>(value));
+        }
+    };
+    if (indexedPaths.find(path) != indexedPaths.end())
+    {
+        write();
+        return;
+    }
 
-                std::variant<double> value(threshold.value);
-                conn->async_method_call(
-                    [](const boost::system::error_code& ec) {
-                        if (ec)
-                        {
-                            std::cerr << "Error setting threshold " << ec
-                                      << "\n";
-                        }
-                    },
-                    entityManagerName, path, "org.freedesktop.DBus.Properties",
-                    "Set", thresholdInterface, "Value", value);
-            },
-            entityManagerName, path, "org.freedesktop.DBus.Properties",
-            "GetAll", thresholdInterface);
+    auto waiters = indexWaiters.find(path);
+    if (waiters != indexWaiters.end())
+    {
+        // the index of path is being fetched
+        waiters->second.emplace_back(std::move(write));
+        return;
     }
+    indexWaiters[path].emplace_back(std::move(write));
+    fetchThresholdIndex(conn, path, baseInterface, thresholdCount);
 }
 
 void updateThresholds(Sensor* sensor)
 {
+    sensor->syncThresholds();
     if (sensor->thresholds.empty())
     {
         return;
@@ -196,204 +370,311 @@ void updateThresholds(Sensor* sensor)
 
     for (const auto& threshold : sensor->thresholds)
     {
-        std::shared_ptr<sdbusplus::asio::dbus_interface> interface;
-        std::string property;
-        if (threshold.level == thresholds::Level::CRITICAL)
-        {
-            interface = sensor->thresholdInterfaceCritical;
-            if (threshold.direction == thresholds::Direction::HIGH)
-            {
-                property = "CriticalHigh";
-            }
-            else
-            {
-                property = "CriticalLow";
-            }
-        }
-        else if (threshold.level == thresholds::Level::WARNING)
-        {
-            interface = sensor->thresholdInterfaceWarning;
-            if (threshold.direction == thresholds::Direction::HIGH)
-            {
-                property = "WarningHigh";
-            }
-            else
-            {
-                property = "WarningLow";
-            }
-        }
-        else
-        {
-            continue;
-        }
+        const std::shared_ptr<sdbusplus::asio::dbus_interface>& interface =
+            sensor->alarmProperties[slot(threshold.level, threshold.direction)]
+                .interface;
         if (!interface)
         {
             continue;
         }
-        interface->set_property(property, threshold.value);
+        interface->set_property(
+            thresholdProperties[slot(threshold.level, threshold.direction)],
+            threshold.value);
     }
 }
 
-// Debugging counters
-static int cHiTrue = 0;
-static int cHiFalse = 0;
-static int cHiMidstate = 0;
-static int cLoTrue = 0;
-static int cLoFalse = 0;
-static int cLoMidstate = 0;
-static int cDebugThrottle = 0;
-
-static std::vector<std::pair<Threshold, bool>> checkThresholds(Sensor* sensor,
-                                                               double value)
+bool checkThresholds(Sensor* sensor)
 {
-    std::vector<std::pair<Threshold, bool>> thresholdChanges;
-    if (sensor->thresholds.empty())
+    SensorRegistry& registry = SensorRegistry::get();
+    uint8_t changed = evaluate(registry, sensor->id);
+    for (const auto& [level, direction] : alarmSlots)
     {
-        return thresholdChanges;
+        uint8_t bit = alarmBit(level, direction);
+        if (changed & bit)
+        {
+            assertThresholds(sensor, level, direction,
+                             !(registry.alarms[sensor->id] & bit));
+        }
     }
 
-    for (auto& threshold : sensor->thresholds)
+    constexpr uint8_t critical =
+        alarmBit(Level::CRITICAL, Direction::HIGH) |
+        alarmBit(Level::CRITICAL, Direction::LOW);
+    return !(registry.alarms[sensor->id] & critical);
+}
+
+void checkThresholdsPowerDelay(Sensor* sensor, ThresholdTimer& thresholdTimer)
+{
+    SensorRegistry& registry = SensorRegistry::get();
+    // a pending alarm counts as asserted, so it is not started again and a
+    // recovery cancels it
+    uint8_t alarms = static_cast<uint8_t>(registry.alarms[sensor->id] |
+                                          thresholdTimer.getPending());
+    uint8_t changed = evaluate(registry, sensor->id, alarms);
+    if (!changed)
     {
-        // Use "Schmitt trigger" logic to avoid threshold trigger spam,
-        // if value is noisy while hovering very close to a threshold.
-        // When a threshold is crossed, indicate true immediately,
-        // but require more distance to be crossed the other direction,
-        // before resetting the indicator back to false.
-        if (threshold.direction == thresholds::Direction::HIGH)
+        return;
+    }
+    for (const auto& threshold : sensor->thresholds)
+    {
+        uint8_t bit = alarmBit(threshold.level, threshold.direction);
+        if (!(changed & bit))
         {
-            if (value >= threshold.value)
-            {
-                thresholdChanges.push_back(std::make_pair(threshold, true));
-                ++cHiTrue;
-            }
-            else if (value < (threshold.value - sensor->hysteresisTrigger))
-            {
-                thresholdChanges.push_back(std::make_pair(threshold, false));
-                ++cHiFalse;
-            }
-            else
-            {
-                ++cHiMidstate;
-            }
+            continue;
         }
-        else if (threshold.direction == thresholds::Direction::LOW)
+        // one timer or deassert per level and direction
+        changed &= static_cast<uint8_t>(~bit);
+        if (!(alarms & bit))
         {
-            if (value <= threshold.value)
-            {
-                thresholdChanges.push_back(std::make_pair(threshold, true));
-                ++cLoTrue;
-            }
-            else if (value > (threshold.value + sensor->hysteresisTrigger))
-            {
-                thresholdChanges.push_back(std::make_pair(threshold, false));
-                ++cLoFalse;
-            }
-            else
-            {
-                ++cLoMidstate;
-            }
+            thresholdTimer.startTimer(threshold);
         }
         else
         {
-            std::cerr << "Error determining threshold direction\n";
+            thresholdTimer.stopTimer(threshold.level, threshold.direction);
+            assertThresholds(sensor, threshold.level, threshold.direction,
+                             false);
         }
     }
+}
 
-    if constexpr (DEBUG)
+ThresholdTimer::ThresholdTimer(boost::asio::io_service& ioService,
+                               Sensor* sensor) :
+    queue(ThresholdTimerQueue::get(ioService)),
+    sensor(sensor)
+{
+    for (const auto& [level, direction] : alarmSlots)
     {
-        // Throttle debug output, so that it does not continuously spam
-        ++cDebugThrottle;
-        if (cDebugThrottle >= 1000)
-        {
-            cDebugThrottle = 0;
-            std::cerr << "checkThresholds: High T=" << cHiTrue
-                      << " F=" << cHiFalse << " M=" << cHiMidstate
-                      << ", Low T=" << cLoTrue << " F=" << cLoFalse
-                      << " M=" << cLoMidstate << "\n";
-        }
+        Entry& entry = entries[slot(level, direction)];
+        entry.owner = this;
+        entry.level = level;
+        entry.direction = direction;
     }
+}
 
-    return thresholdChanges;
+ThresholdTimer::~ThresholdTimer()
+{
+    for (const auto& [level, direction] : alarmSlots)
+    {
+        stopTimer(level, direction);
+    }
 }
 
-bool checkThresholds(Sensor* sensor)
+void ThresholdTimer::startTimer(const Threshold& threshold)
 {
-    bool status = true;
-    std::vector<std::pair<Threshold, bool>> changes =
-        checkThresholds(sensor, sensor->value);
-    for (const auto& [threshold, asserted] : changes)
+    uint8_t bit = alarmBit(threshold.level, threshold.direction);
+    if (pending & bit)
     {
-        assertThresholds(sensor, threshold.level, threshold.direction,
-                         asserted);
-        if (threshold.level == thresholds::Level::CRITICAL && asserted)
-        {
-            status = false;
-        }
+        return;
+    }
+    setPending(pending | bit);
+    queue.push(entries[slot(threshold.level, threshold.direction)]);
+}
+
+void ThresholdTimer::stopTimer(Level level, Direction direction)
+{
+    uint8_t bit = alarmBit(level, direction);
+    if (!(pending & bit))
+    {
+        return;
     }
+    setPending(pending & static_cast<uint8_t>(~bit));
+    queue.erase(entries[slot(level, direction)]);
+}
 
-    return status;
+void ThresholdTimer::setPending(uint8_t bits)
+{
+    pending = bits;
+    SensorRegistry::get().pendingAlarms[sensor->id] = bits;
 }
 
-void checkThresholdsPowerDelay(Sensor* sensor, ThresholdTimer& thresholdTimer)
+ThresholdTimerQueue::ThresholdTimerQueue(boost::asio::io_service& io) :
+    timer(io)
+{
+}
+
+ThresholdTimerQueue& ThresholdTimerQueue::get(boost::asio::io_service& io)
 {
+    // never destroyed, sensors held in statics stop their timers at exit
+    static ThresholdTimerQueue* queue = new ThresholdTimerQueue(io);
+    return *queue;
+}
+
+void ThresholdTimerQueue::push(ThresholdTimer::Entry& entry)
+{
+    entry.deadline = boost::posix_time::microsec_clock::universal_time() +
+                     boost::posix_time::seconds(waitTimeS);
+    entry.prev = tail;
+    entry.next = nullptr;
+    if (tail != nullptr)
+    {
+        tail->next = &entry;
+        tail = &entry;
+        return;
+    }
+    head = tail = &entry;
+    arm();
+}
 
-    std::vector<std::pair<Threshold, bool>> changes =
-        checkThresholds(sensor, sensor->value);
-    for (const auto& [threshold, asserted] : changes)
+void ThresholdTimerQueue::erase(ThresholdTimer::Entry& entry)
+{
+    if (entry.next != nullptr)
+    {
+        entry.next->prev = entry.prev;
+    }
+    else
     {
-        if (asserted)
+        tail = entry.prev;
+    }
+    if (entry.prev != nullptr)
+    {
+        entry.prev->next = entry.next;
+        entry.prev = nullptr;
+        entry.next = nullptr;
+        return;
+    }
+    head = entry.next;
+    entry.next = nullptr;
+    arm();
+}
+
+void ThresholdTimerQueue::arm(void)
+{
+    if (head == nullptr)
+    {
+        timer.cancel();
+        return;
+    }
+    timer.expires_at(head->deadline);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
         {
-            thresholdTimer.startTimer(threshold);
+            return; // rearmed or emptied
         }
-        else
+        else if (ec)
         {
-            assertThresholds(sensor, threshold.level, threshold.direction,
-                             false);
+            std::cerr << "timer error: " << ec.message() << "\n";
+            return;
         }
-    }
+        expire();
+    });
 }
 
-void assertThresholds(Sensor* sensor, thresholds::Level level,
-                      thresholds::Direction direction, bool assert)
+void ThresholdTimerQueue::expire(void)
 {
-    std::string property;
-    std::shared_ptr<sdbusplus::asio::dbus_interface> interface;
-    if (level == thresholds::Level::WARNING &&
-        direction == thresholds::Direction::HIGH)
+    boost::posix_time::ptime now =
+        boost::posix_time::microsec_clock::universal_time();
+    while (head != nullptr && head->deadline <= now)
     {
-        property = "WarningAlarmHigh";
-        interface = sensor->thresholdInterfaceWarning;
+        ThresholdTimer::Entry& entry = *head;
+        ThresholdTimer& owner = *entry.owner;
+        head = entry.next;
+        if (head != nullptr)
+        {
+            head->prev = nullptr;
+        }
+        else
+        {
+            tail = nullptr;
+        }
+        entry.next = nullptr;
+        owner.setPending(owner.pending &
+                         static_cast<uint8_t>(
+                             ~alarmBit(entry.level, entry.direction)));
+        if (isPowerOn())
+        {
+            assertThresholds(owner.sensor, entry.level, entry.direction,
+                             true);
+        }
     }
-    else if (level == thresholds::Level::WARNING &&
-             direction == thresholds::Direction::LOW)
+    arm();
+}
+
+static ThresholdChecker* checker = nullptr;
+
+ThresholdChecker::ThresholdChecker(boost::asio::io_service& io) : io(io)
+{
+}
+
+ThresholdChecker& ThresholdChecker::create(boost::asio::io_service& io)
+{
+    // never destroyed, like the publish stage it has to outlive the sensors
+    if (checker == nullptr)
     {
-        property = "WarningAlarmLow";
-        interface = sensor->thresholdInterfaceWarning;
+        checker = new ThresholdChecker(io);
     }
-    else if (level == thresholds::Level::CRITICAL &&
-             direction == thresholds::Direction::HIGH)
+    return *checker;
+}
+
+ThresholdChecker* ThresholdChecker::get(void)
+{
+    return checker;
+}
+
+void ThresholdChecker::add(SensorRegistry::SensorId id)
+{
+    dirty.push_back(id);
+    if (checkPending)
     {
-        property = "CriticalAlarmHigh";
-        interface = sensor->thresholdInterfaceCritical;
+        return;
     }
-    else if (level == thresholds::Level::CRITICAL &&
-             direction == thresholds::Direction::LOW)
+    checkPending = true;
+    io.post([this]() { check(); });
+}
+
+void ThresholdChecker::check(void)
+{
+    checkPending = false;
+    checking.swap(dirty);
+    SensorRegistry& registry = SensorRegistry::get();
+    transitions.resize(checking.size());
+    if (evaluate(registry, checking.data(), checking.size(),
+                 transitions.data()))
     {
-        property = "CriticalAlarmLow";
-        interface = sensor->thresholdInterfaceCritical;
+        for (size_t ii = 0; ii < checking.size(); ii++)
+        {
+            // a sensor removed since it changed has nothing left to check
+            Sensor* sensor = registry.getSensor(checking[ii]);
+            if (transitions[ii] != 0 && sensor != nullptr)
+            {
+                sensor->checkThresholds();
+            }
+        }
     }
-    else
+    checking.clear();
+}
+
+void assertThresholds(Sensor* sensor, thresholds::Level level,
+                      thresholds::Direction direction, bool assert)
+{
+    SensorRegistry& registry = SensorRegistry::get();
+    uint8_t bit = alarmBit(level, direction);
+    uint8_t alarms = registry.alarms[sensor->id];
+    if (static_cast<bool>(alarms & bit) == assert)
     {
-        std::cerr << "Unknown threshold, level " << level << "direction "
-                  << direction << "\n";
+        // only transitions are signalled
         return;
     }
-    if (!interface)
+
+    const Sensor::AlarmProperty& property =
+        sensor->alarmProperties[slot(level, direction)];
+    if (!property.interface)
     {
         std::cout << "trying to set uninitialized interface\n";
         return;
     }
-    interface->set_property(property, assert);
+    sensor->flushValue();
+    property.interface->set_property(property.name, assert);
+
+    if (assert)
+    {
+        alarms |= bit;
+    }
+    else
+    {
+        alarms &= static_cast<uint8_t>(~bit);
+    }
+    registry.alarms[sensor->id] = alarms;
+    registry.touch(sensor->id);
 }
 
 static constexpr std::array<const char*, 4> attrTypes = {"lcrit", "min", "max",
@@ -16,8 +16,13 @@
 
 #include "Utils.hpp"
 
+#include "ConfigCache.hpp"
+
+#include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/container/flat_map.hpp>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <memory>
@@ -33,6 +38,13 @@
 
 namespace fs = std::filesystem;
 
+static constexpr bool DEBUG = false;
+
+// PollRate is bounded to these, a shorter period than the poll scheduler's
+// tick would be a busy poll
+static constexpr double minPollRateMs = 10;
+static constexpr double maxPollRateMs = 3600 * 1000;
+
 static bool powerStatusOn = false;
 static bool biosHasPost = false;
 
@@ -42,18 +54,17 @@ static std::unique_ptr<sdbusplus::bus::match::match> postMatch = nullptr;
 bool getSensorConfiguration(
     const std::string& type,
     const std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
-    ManagedObjectType& resp, bool useCache)
+    ManagedObjectType& resp, bool /*useCache*/)
 {
-    static ManagedObjectType managedObj;
-
-    if (!useCache)
+    ConfigCache& cache = ConfigCache::get(dbusConnection);
+    if (!cache.isLoaded())
     {
-        managedObj.clear();
+        // only before the read main starts has completed
+        ManagedObjectType managedObj;
         sdbusplus::message::message getManagedObjects =
             dbusConnection->new_method_call(
                 entityManagerName, "/", "org.freedesktop.DBus.ObjectManager",
                 "GetManagedObjects");
-        bool err = false;
         try
         {
             sdbusplus::message::message reply =
@@ -66,32 +77,158 @@ bool getSensorConfiguration(
                       << entityManagerName << " exception name:" << e.name()
                       << "and description:" << e.description()
                       << " was thrown\n";
-            err = true;
-        }
-
-        if (err)
-        {
             std::cerr << "Error communicating to entity manager\n";
             return false;
         }
+        cache.assign(std::move(managedObj));
     }
-    for (const auto& pathPair : managedObj)
+    cache.find(type, resp);
+    return true;
+}
+
+void GetSensorConfiguration::getConfiguration(
+    const std::vector<std::string>& interfaces)
+{
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<GetSensorConfiguration> self = shared_from_this();
+    dbusConnection->async_method_call(
+        [self, interfaces](const boost::system::error_code ec,
+                           const GetSubTreeType& ret) {
+            self->mapperDone = std::chrono::steady_clock::now();
+            if (ec)
+            {
+                std::cerr << "Error calling mapper\n";
+                return;
+            }
+            boost::container::flat_map<std::string, std::vector<Target>>
+                byOwner;
+            for (const auto& [path, objDict] : ret)
+            {
+                if (objDict.empty())
+                {
+                    continue;
+                }
+                const std::string& owner = objDict.begin()->first;
+
+                for (const std::string& interface : objDict.begin()->second)
+                {
+                    // anything that starts with a requested configuration
+                    // is good
+                    if (std::find_if(
+                            interfaces.begin(), interfaces.end(),
+                            [interface](const std::string& possible) {
+                                return boost::starts_with(interface,
+                                                          possible);
+                            }) == interfaces.end())
+                    {
+                        continue;
+                    }
+                    byOwner[owner].emplace_back(path, interface);
+                }
+            }
+            for (auto& [owner, targets] : byOwner)
+            {
+                self->queue.push_back(
+                    Request{owner, std::move(targets), true});
+            }
+            self->dispatch();
+        },
+        mapper::busName, mapper::path, mapper::interface, mapper::subtree, "/",
+        0, interfaces);
+}
+
+void GetSensorConfiguration::dispatch(void)
+{
+    while (inFlight < maxInFlight && !queue.empty())
     {
-        bool correctType = false;
-        for (const auto& entry : pathPair.second)
-        {
-            if (boost::starts_with(entry.first, type))
+        Request request = std::move(queue.front());
+        queue.pop_front();
+        send(std::move(request));
+    }
+}
+
+void GetSensorConfiguration::done(void)
+{
+    inFlight--;
+    dispatch();
+}
+
+void GetSensorConfiguration::send(Request&& request)
+{
+    std::shared_ptr<GetSensorConfiguration> self = shared_from_this();
+    inFlight++;
+    if (!request.managed)
+    {
+        getAllCalls++;
+        const auto& [path, interface] = request.targets.front();
+        dbusConnection->async_method_call(
+            [self, path{path}, interface{interface}](
+                const boost::system::error_code ec,
+                boost::container::flat_map<std::string, BasicVariantType>&
+                    data) {
+                if (ec)
+                {
+                    std::cerr << "Error getting " << path << "\n";
+                }
+                else
+                {
+                    self->respData[path][interface] = std::move(data);
+                }
+                self->done();
+            },
+            request.owner, path, "org.freedesktop.DBus.Properties", "GetAll",
+            interface);
+        return;
+    }
+
+    managedCalls++;
+    std::string owner = request.owner;
+    dbusConnection->async_method_call(
+        [self, request{std::move(request)}](const boost::system::error_code ec,
+                                            ManagedObjectType& objects) {
+            for (const Target& target : request.targets)
             {
-                correctType = true;
-                break;
+                const auto& [path, interface] = target;
+                if (!ec)
+                {
+                    auto object =
+                        objects.find(sdbusplus::message::object_path(path));
+                    if (object != objects.end())
+                    {
+                        auto data = object->second.find(interface);
+                        if (data != object->second.end())
+                        {
+                            self->respData[path][interface] =
+                                std::move(data->second);
+                            continue;
+                        }
+                    }
+                }
+                // no ObjectManager at the root or it does not cover path
+                self->queue.push_back(Request{request.owner, {target}, false});
             }
-        }
-        if (correctType)
-        {
-            resp.emplace(pathPair);
-        }
+            self->done();
+        },
+        owner, "/", "org.freedesktop.DBus.ObjectManager", "GetManagedObjects");
+}
+
+GetSensorConfiguration::~GetSensorConfiguration()
+{
+    auto end = std::chrono::steady_clock::now();
+    if (DEBUG && mapperDone != std::chrono::steady_clock::time_point())
+    {
+        std::cerr << "Configuration fetch: mapper "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         mapperDone - start)
+                         .count()
+                  << " ms, objects "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         end - mapperDone)
+                         .count()
+                  << " ms, " << managedCalls << " GetManagedObjects, "
+                  << getAllCalls << " GetAll\n";
     }
-    return true;
+    callback(respData);
 }
 
 bool findFiles(const fs::path dirPath, const std::string& matchString,
@@ -253,6 +390,39 @@ void findLimits(std::pair<double, double>& limits,
     }
 }
 
+unsigned int getPollRate(const SensorBaseConfigMap& baseConfig,
+                         unsigned int defaultMs)
+{
+    auto findPollRate = baseConfig.find("PollRate");
+    if (findPollRate == baseConfig.end())
+    {
+        return defaultMs;
+    }
+    double pollRate = 0;
+    try
+    {
+        pollRate = std::visit(VariantToDoubleVisitor(), findPollRate->second);
+    }
+    catch (const std::invalid_argument&)
+    {
+        std::cerr << "Ignoring PollRate that is not a number\n";
+        return defaultMs;
+    }
+    if (!std::isfinite(pollRate) || pollRate <= 0)
+    {
+        std::cerr << "Ignoring invalid PollRate " << pollRate << "\n";
+        return defaultMs;
+    }
+    double pollMs = pollRate * 1000;
+    if (pollMs < minPollRateMs || pollMs > maxPollRateMs)
+    {
+        pollMs = std::clamp(pollMs, minPollRateMs, maxPollRateMs);
+        std::cerr << "PollRate " << pollRate << " limited to " << pollMs
+                  << " ms\n";
+    }
+    return static_cast<unsigned int>(pollMs);
+}
+
 void createAssociation(
     std::shared_ptr<sdbusplus::asio::dbus_interface>& association,
     const std::string& path)